@@ -17,11 +17,13 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 #include <algorithm>
 #include "NDS.h"
 #include "DSi.h"
 #include "ARM.h"
 #include "ARMInterpreter.h"
+#include "ARM_InstrInfo.h"
 #include "AREngine.h"
 #include "ARMJIT.h"
 
@@ -100,14 +102,15 @@ ARMv5::~ARMv5()
 void ARM::Reset()
 {
     Cycles = 0;
-    Halted = 0;
 
-    IRQ = 0;
+    // also clears Halted, IRQ and IdleLoop
+    StopExecution = 0;
 
     for (int i = 0; i < 16; i++)
         R[i] = 0;
 
     CPSR = 0x000000D3;
+    LazyFlagsOp = LazyFlags_None;
 
     for (int i = 0; i < 7; i++)
         R_FIQ[i] = 0;
@@ -129,6 +132,10 @@ void ARM::Reset()
 
     CodeMem.Mem = NULL;
 
+    IdleLoopBranchAddr = 0xFFFFFFFF;
+    IdleLoopSize = 0;
+    IdleLoopBranchIdle = false;
+
 #ifdef JIT_ENABLED
     FastBlockLookup = NULL;
     FastBlockLookupStart = 0;
@@ -177,6 +184,7 @@ void ARMv4::Reset()
         BusWrite8 = DSi::ARM7Write8;
         BusWrite16 = DSi::ARM7Write16;
         BusWrite32 = DSi::ARM7Write32;
+        GetMemRegion = DSi::ARM7GetMemRegion;
     }
     else
     {
@@ -186,6 +194,7 @@ void ARMv4::Reset()
         BusWrite8 = NDS::ARM7Write8;
         BusWrite16 = NDS::ARM7Write16;
         BusWrite32 = NDS::ARM7Write32;
+        GetMemRegion = NDS::ARM7GetMemRegion;
     }
 
     ARM::Reset();
@@ -205,6 +214,7 @@ void ARM::DoSavestate(Savestate* file)
     Halted = halted;
 
     file->VarArray(R, 16*sizeof(u32));
+    MaterializeFlags();
     file->Var32(&CPSR);
     file->VarArray(R_FIQ, 8*sizeof(u32));
     file->VarArray(R_SVC, 3*sizeof(u32));
@@ -234,10 +244,12 @@ void ARM::DoSavestate(Savestate* file)
         R_IRQ[2] |= 0x00000010;
         R_UND[2] |= 0x00000010;
 
+        IdleLoopBranchAddr = 0xFFFFFFFF;
+
         if (!Num)
         {
             SetupCodeMem(R[15]); // should fix it
-            ((ARMv5*)this)->RegionCodeCycles = ((ARMv5*)this)->MemTimings[R[15] >> 12][0];
+            ((ARMv5*)this)->RegionCodeCycles = ((ARMv5*)this)->MemTimings(R[15])[0];
 
             if ((CPSR & 0x1F) == 0x10)
                 ((ARMv5*)this)->PU_Map = ((ARMv5*)this)->PU_UserMap;
@@ -246,6 +258,7 @@ void ARM::DoSavestate(Savestate* file)
         }
         else
         {
+            SetupCodeMem(R[15]);
             CodeRegion = R[15] >> 24;
             CodeCycles = R[15] >> 15; // cheato
         }
@@ -267,13 +280,69 @@ void ARM::SetupCodeMem(u32 addr)
     }
     else
     {
-        // not sure it's worth it for the ARM7
-        // esp. as everything there generally runs on WRAM
-        // and due to how it's mapped, we can't use this optimization
-        //NDS::ARM7GetMemRegion(addr, false, &CodeMem);
+        // shared WRAM mapped to the ARM7 is left to the slow path
+        // since it's usually accessed as one block together with WRAM
+        ((ARMv4*)this)->GetMemRegion(addr, false, &CodeMem);
     }
 }
 
+void ARM::CheckIdleLoopSlow(bool thumb, u32 loopAddr, u32 branchAddr)
+{
+    NDS::MemRegion region;
+    bool found;
+    if (Num == 0)
+    {
+        ARMv5* arm9 = (ARMv5*)this;
+        if (loopAddr < arm9->ITCMSize)
+        {
+            region.Mem = arm9->ITCM;
+            region.Mask = ITCMPhysicalSize - 1;
+            found = true;
+        }
+        else
+            found = arm9->GetMemRegion(loopAddr, false, &region);
+    }
+    else
+        found = ((ARMv4*)this)->GetMemRegion(loopAddr, false, &region);
+
+    if (!found)
+        return;
+
+    // the loop body is part of the key, the code might have been
+    // overwritten since it was last looked at
+    u32 instrs[MaxIdleLoopSize];
+    int count = 0;
+    for (u32 addr = loopAddr; addr <= branchAddr; addr += thumb ? 2 : 4)
+    {
+        instrs[count++] = thumb
+            ? *(u16*)&region.Mem[addr & region.Mask]
+            : *(u32*)&region.Mem[addr & region.Mask];
+    }
+
+    if (IdleLoopBranchAddr != (branchAddr | thumb) || IdleLoopSize != count
+        || memcmp(IdleLoopInstrs, instrs, count * sizeof(u32)))
+    {
+        IdleLoopBranchAddr = branchAddr | thumb;
+        IdleLoopSize = count;
+        memcpy(IdleLoopInstrs, instrs, count * sizeof(u32));
+        IdleLoopBranchIdle = false;
+
+        ARMInstrInfo::Info infos[MaxIdleLoopSize];
+        for (int i = 0; i < count; i++)
+            infos[i] = ARMInstrInfo::Decode(thumb, Num, instrs[i]);
+
+        // only plain branches can close a loop
+        u16 kind = infos[count - 1].Kind;
+        if (thumb ? (kind != ARMInstrInfo::tk_BCOND && kind != ARMInstrInfo::tk_B) : kind != ARMInstrInfo::ak_B)
+            return;
+
+        IdleLoopBranchIdle = ARMInstrInfo::IsIdleLoop(thumb, loopAddr, instrs, infos, count);
+    }
+
+    if (IdleLoopBranchIdle)
+        IdleLoop = 1;
+}
+
 void ARMv5::JumpTo(u32 addr, bool restorecpsr)
 {
     if (restorecpsr)
@@ -291,7 +360,7 @@ void ARMv5::JumpTo(u32 addr, bool restorecpsr)
     u32 oldregion = R[15] >> 24;
     u32 newregion = addr >> 24;
 
-    RegionCodeCycles = MemTimings[addr >> 12][0];
+    RegionCodeCycles = MemTimings(addr)[0];
 
     if (addr & 0x1)
     {
@@ -363,11 +432,11 @@ void ARMv4::JumpTo(u32 addr, bool restorecpsr)
         addr &= ~0x1;
         R[15] = addr+2;
 
-        //if (newregion != oldregion) SetupCodeMem(addr);
+        if (newregion != oldregion) SetupCodeMem(addr);
 
         NextInstr[0] = CodeRead16(addr);
         NextInstr[1] = CodeRead16(addr+2);
-        Cycles += NDS::ARM7MemTimings[CodeCycles][0] + NDS::ARM7MemTimings[CodeCycles][1];
+        Cycles += NDS::ARM7MemTimings(CodeCycles)[0] + NDS::ARM7MemTimings(CodeCycles)[1];
 
         CPSR |= 0x20;
     }
@@ -376,18 +445,45 @@ void ARMv4::JumpTo(u32 addr, bool restorecpsr)
         addr &= ~0x3;
         R[15] = addr+4;
 
-        //if (newregion != oldregion) SetupCodeMem(addr);
+        if (newregion != oldregion) SetupCodeMem(addr);
 
         NextInstr[0] = CodeRead32(addr);
         NextInstr[1] = CodeRead32(addr+4);
-        Cycles += NDS::ARM7MemTimings[CodeCycles][2] + NDS::ARM7MemTimings[CodeCycles][3];
+        Cycles += NDS::ARM7MemTimings(CodeCycles)[2] + NDS::ARM7MemTimings(CodeCycles)[3];
 
         CPSR &= ~0x20;
     }
 }
 
+void ARM::MaterializeFlagsSlow()
+{
+    u32 a = LazyFlagsA;
+    u32 b = LazyFlagsB;
+    u32 res = LazyFlagsRes;
+    u32 flags = (res & 0x80000000) | ((u32)!res << 30);
+
+    switch (LazyFlagsOp)
+    {
+    case LazyFlags_NZ:
+        flags |= CPSR & 0x30000000;
+        break;
+
+    case LazyFlags_Add:
+        flags |= ((u32)(res < a) << 29) | (((~(a ^ b) & (a ^ res)) >> 31) << 28);
+        break;
+
+    case LazyFlags_Sub:
+        flags |= ((u32)(a >= b) << 29) | ((((a ^ b) & (a ^ res)) >> 31) << 28);
+        break;
+    }
+
+    CPSR = (CPSR & ~0xF0000000) | flags;
+    LazyFlagsOp = LazyFlags_None;
+}
+
 void ARM::RestoreCPSR()
 {
+    MaterializeFlags();
     u32 oldcpsr = CPSR;
 
     switch (CPSR & 0x1F)
@@ -512,6 +608,7 @@ void ARM::TriggerIRQ()
     if (CPSR & 0x80)
         return;
 
+    MaterializeFlags();
     u32 oldcpsr = CPSR;
     CPSR &= ~0xFF;
     CPSR |= 0xD2;
@@ -534,6 +631,7 @@ void ARMv5::PrefetchAbort()
 {
     printf("ARM9: prefetch abort (%08X)\n", R[15]);
 
+    MaterializeFlags();
     u32 oldcpsr = CPSR;
     CPSR &= ~0xBF;
     CPSR |= 0x97;
@@ -557,6 +655,7 @@ void ARMv5::DataAbort()
 {
     printf("ARM9: data abort (%08X)\n", R[15]);
 
+    MaterializeFlags();
     u32 oldcpsr = CPSR;
     CPSR &= ~0xBF;
     CPSR |= 0x97;
@@ -588,6 +687,9 @@ void ARMv5::Execute()
         }
     }
 
+#if defined(THREADED_INTERP_ENABLED) && defined(__GNUC__)
+    ARMInterpreter::ExecuteThreaded(this);
+#else
     while (NDS::ARM9Timestamp < NDS::ARM9Target)
     {
         if (CPSR & 0x20) // THUMB
@@ -600,8 +702,11 @@ void ARMv5::Execute()
             else             NextInstr[1] = CodeRead32(R[15], false);
 
             // actually execute
+            u32 instrAddr = R[15] - 4;
             u32 icode = (CurInstr >> 6) & 0x3FF;
             ARMInterpreter::THUMBInstrTable[icode](this);
+
+            CheckIdleLoop(true, instrAddr);
         }
         else
         {
@@ -612,10 +717,13 @@ void ARMv5::Execute()
             NextInstr[1] = CodeRead32(R[15], false);
 
             // actually execute
+            u32 instrAddr = R[15] - 8;
             if (CheckCondition(CurInstr >> 28))
             {
                 u32 icode = ((CurInstr >> 4) & 0xF) | ((CurInstr >> 16) & 0xFF0);
                 ARMInterpreter::ARMInstrTable[icode](this);
+
+                CheckIdleLoop(false, instrAddr);
             }
             else if ((CurInstr & 0xFE000000) == 0xFA000000)
             {
@@ -625,25 +733,37 @@ void ARMv5::Execute()
                 AddCycles_C();
         }
 
-        // TODO optimize this shit!!!
-        if (Halted)
+        // halting, idle loops and IRQs are rare, only check them all
+        // when at least one of them is pending
+        if (StopExecution)
         {
-            if (Halted == 1 && NDS::ARM9Timestamp < NDS::ARM9Target)
+            if (Halted)
             {
-                NDS::ARM9Timestamp = NDS::ARM9Target;
+                if (Halted == 1 && NDS::ARM9Timestamp < NDS::ARM9Target)
+                {
+                    NDS::ARM9Timestamp = NDS::ARM9Target;
+                }
+                break;
+            }
+            if (IdleLoop)
+            {
+                // nothing is going to change until the next event
+                // unless there's an IRQ to take
+                IdleLoop = 0;
+                if (!IRQ || (CPSR & 0x80))
+                {
+                    Cycles = 0;
+                    NDS::ARM9Timestamp = NDS::ARM9Target;
+                    break;
+                }
             }
-            break;
+            if (IRQ) TriggerIRQ();
         }
-        /*if (NDS::IF[0] & NDS::IE[0])
-        {
-            if (NDS::IME[0] & 0x1)
-                TriggerIRQ();
-        }*/
-        if (IRQ) TriggerIRQ();
 
         NDS::ARM9Timestamp += Cycles;
         Cycles = 0;
     }
+#endif
 
     if (Halted == 2)
         Halted = 0;
@@ -652,6 +772,9 @@ void ARMv5::Execute()
 #ifdef JIT_ENABLED
 void ARMv5::ExecuteJIT()
 {
+    // compiled code works on CPSR directly
+    MaterializeFlags();
+
     if (Halted)
     {
         if (Halted == 2)
@@ -688,7 +811,11 @@ void ARMv5::ExecuteJIT()
         if (block)
             ARM_Dispatch(this, block);
         else
+        {
+            // new blocks are interpreted while they're compiled
             ARMJIT::CompileBlock(this);
+            MaterializeFlags();
+        }
 
         if (StopExecution)
         {
@@ -738,6 +865,9 @@ void ARMv4::Execute()
         }
     }
 
+#if defined(THREADED_INTERP_ENABLED) && defined(__GNUC__)
+    ARMInterpreter::ExecuteThreaded(this);
+#else
     while (NDS::ARM7Timestamp < NDS::ARM7Target)
     {
         if (CPSR & 0x20) // THUMB
@@ -749,8 +879,11 @@ void ARMv4::Execute()
             NextInstr[1] = CodeRead16(R[15]);
 
             // actually execute
+            u32 instrAddr = R[15] - 4;
             u32 icode = (CurInstr >> 6);
             ARMInterpreter::THUMBInstrTable[icode](this);
+
+            CheckIdleLoop(true, instrAddr);
         }
         else
         {
@@ -761,34 +894,49 @@ void ARMv4::Execute()
             NextInstr[1] = CodeRead32(R[15]);
 
             // actually execute
+            u32 instrAddr = R[15] - 8;
             if (CheckCondition(CurInstr >> 28))
             {
                 u32 icode = ((CurInstr >> 4) & 0xF) | ((CurInstr >> 16) & 0xFF0);
                 ARMInterpreter::ARMInstrTable[icode](this);
+
+                CheckIdleLoop(false, instrAddr);
             }
             else
                 AddCycles_C();
         }
 
-        // TODO optimize this shit!!!
-        if (Halted)
+        // halting, idle loops and IRQs are rare, only check them all
+        // when at least one of them is pending
+        if (StopExecution)
         {
-            if (Halted == 1 && NDS::ARM7Timestamp < NDS::ARM7Target)
+            if (Halted)
             {
-                NDS::ARM7Timestamp = NDS::ARM7Target;
+                if (Halted == 1 && NDS::ARM7Timestamp < NDS::ARM7Target)
+                {
+                    NDS::ARM7Timestamp = NDS::ARM7Target;
+                }
+                break;
             }
-            break;
+            if (IdleLoop)
+            {
+                // nothing is going to change until the next event
+                // unless there's an IRQ to take
+                IdleLoop = 0;
+                if (!IRQ || (CPSR & 0x80))
+                {
+                    Cycles = 0;
+                    NDS::ARM7Timestamp = NDS::ARM7Target;
+                    break;
+                }
+            }
+            if (IRQ) TriggerIRQ();
         }
-        /*if (NDS::IF[1] & NDS::IE[1])
-        {
-            if (NDS::IME[1] & 0x1)
-                TriggerIRQ();
-        }*/
-        if (IRQ) TriggerIRQ();
 
         NDS::ARM7Timestamp += Cycles;
         Cycles = 0;
     }
+#endif
 
     if (Halted == 2)
         Halted = 0;
@@ -803,6 +951,9 @@ void ARMv4::Execute()
 #ifdef JIT_ENABLED
 void ARMv4::ExecuteJIT()
 {
+    // compiled code works on CPSR directly
+    MaterializeFlags();
+
     if (Halted)
     {
         if (Halted == 2)
@@ -839,7 +990,11 @@ void ARMv4::ExecuteJIT()
         if (block)
             ARM_Dispatch(this, block);
         else
+        {
+            // new blocks are interpreted while they're compiled
             ARMJIT::CompileBlock(this);
+            MaterializeFlags();
+        }
 
         if (StopExecution)
         {
@@ -38,6 +38,17 @@ enum
 const u32 ITCMPhysicalSize = 0x8000;
 const u32 DTCMPhysicalSize = 0x4000;
 
+// longest loop (in instructions) the interpreter checks for being an idle loop
+const u32 MaxIdleLoopSize = 16;
+
+enum
+{
+    LazyFlags_None = 0,
+    LazyFlags_NZ,
+    LazyFlags_Add,
+    LazyFlags_Sub,
+};
+
 class ARM
 {
 public:
@@ -67,30 +78,65 @@ public:
     bool CheckCondition(u32 code)
     {
         if (code == 0xE) return true;
+        MaterializeFlags();
         if (ConditionTable[code] & (1 << (CPSR>>28))) return true;
         return false;
     }
 
+    // most flag results are overwritten before anything looks at them,
+    // so the common ALU ops only record their result and operands.
+    // anything reading (or replacing) the flags in CPSR has to call
+    // MaterializeFlags first
+    void MaterializeFlags()
+    {
+        if (LazyFlagsOp != LazyFlags_None)
+            MaterializeFlagsSlow();
+    }
+    void MaterializeFlagsSlow();
+
+    void SetNZLazy(u32 res)
+    {
+        // C and V are kept, so a pending add/sub has to provide them first
+        if (LazyFlagsOp > LazyFlags_NZ)
+            MaterializeFlagsSlow();
+        LazyFlagsOp = LazyFlags_NZ;
+        LazyFlagsRes = res;
+    }
+
+    void SetNZCVAddLazy(u32 a, u32 b, u32 res)
+    {
+        LazyFlagsOp = LazyFlags_Add;
+        LazyFlagsA = a;
+        LazyFlagsB = b;
+        LazyFlagsRes = res;
+    }
+
+    void SetNZCVSubLazy(u32 a, u32 b, u32 res)
+    {
+        LazyFlagsOp = LazyFlags_Sub;
+        LazyFlagsA = a;
+        LazyFlagsB = b;
+        LazyFlagsRes = res;
+    }
+
+    // the flags are shifted into place instead of being set one by one
+    // since they are essentially random, branching on them mispredicts a lot
     void SetC(bool c)
     {
-        if (c) CPSR |= 0x20000000;
-        else CPSR &= ~0x20000000;
+        MaterializeFlags();
+        CPSR = (CPSR & ~0x20000000) | ((u32)c << 29);
     }
 
     void SetNZ(bool n, bool z)
     {
-        CPSR &= ~0xC0000000;
-        if (n) CPSR |= 0x80000000;
-        if (z) CPSR |= 0x40000000;
+        MaterializeFlags();
+        CPSR = (CPSR & ~0xC0000000) | ((u32)n << 31) | ((u32)z << 30);
     }
 
     void SetNZCV(bool n, bool z, bool c, bool v)
     {
-        CPSR &= ~0xF0000000;
-        if (n) CPSR |= 0x80000000;
-        if (z) CPSR |= 0x40000000;
-        if (c) CPSR |= 0x20000000;
-        if (v) CPSR |= 0x10000000;
+        LazyFlagsOp = LazyFlags_None;
+        CPSR = (CPSR & ~0xF0000000) | ((u32)n << 31) | ((u32)z << 30) | ((u32)c << 29) | ((u32)v << 28);
     }
 
     void UpdateMode(u32 oldmode, u32 newmode, bool phony = false);
@@ -99,6 +145,17 @@ public:
 
     void SetupCodeMem(u32 addr);
 
+    void CheckIdleLoop(bool thumb, u32 branchAddr)
+    {
+        // a short jump backwards might close a loop polling for something
+        u32 instrSize = thumb ? 2 : 4;
+        u32 loopAddr = R[15] - instrSize;
+        if (loopAddr <= branchAddr && branchAddr - loopAddr < MaxIdleLoopSize * instrSize
+            && !!(CPSR & 0x20) == thumb)
+            CheckIdleLoopSlow(thumb, loopAddr, branchAddr);
+    }
+    void CheckIdleLoopSlow(bool thumb, u32 loopAddr, u32 branchAddr);
+
 
     virtual void DataRead8(u32 addr, u32* val) = 0;
     virtual void DataRead16(u32 addr, u32* val) = 0;
@@ -149,11 +206,22 @@ public:
 
     NDS::MemRegion CodeMem;
 
+    // the interpreter only remembers whether the last
+    // loop it has looked at was idle
+    u32 IdleLoopBranchAddr;
+    u32 IdleLoopInstrs[MaxIdleLoopSize];
+    int IdleLoopSize;
+    bool IdleLoopBranchIdle;
+
 #ifdef JIT_ENABLED
     u32 FastBlockLookupStart, FastBlockLookupSize;
     u64* FastBlockLookup;
 #endif
 
+    // how the flags were last set, if they aren't in CPSR yet
+    u32 LazyFlagsOp;
+    u32 LazyFlagsA, LazyFlagsB, LazyFlagsRes;
+
     static u32 ConditionTable[16];
 
 protected:
@@ -165,7 +233,7 @@ protected:
     void (*BusWrite32)(u32 addr, u32 val);
 };
 
-class ARMv5 : public ARM
+class ARMv5 final : public ARM
 {
 public:
     ARMv5();
@@ -175,7 +243,12 @@ public:
 
     void DoSavestate(Savestate* file);
 
-    void UpdateRegionTimings(u32 addrstart, u32 addrend);
+    void UpdateRegionTimings();
+
+    u8* MemTimings(u32 addr)
+    {
+        return MemTimingTable[NDS::ARM9RegionIndex[addr >> 14]][(PU_Map[addr >> 12] >> 4) & 0x7];
+    }
 
     void FillPipeline();
 
@@ -296,15 +369,16 @@ public:
     //#define PU_Map PU_PrivMap
     u8* PU_Map;
 
-    // code/16N/32N/32S
-    u8 MemTimings[0x100000][4];
+    // code/16N/32N/32S, for each bus region (NDS::ARM9RegionIndex)
+    // and combination of the PU cache bits (PU_Map >> 4)
+    u8 MemTimingTable[32][8][4];
 
     u8* CurICacheLine;
 
     bool (*GetMemRegion)(u32 addr, bool write, NDS::MemRegion* region);
 };
 
-class ARMv4 : public ARM
+class ARMv4 final : public ARM
 {
 public:
     ARMv4();
@@ -322,11 +396,15 @@ public:
 
     u16 CodeRead16(u32 addr)
     {
+        if (CodeMem.Mem) return *(u16*)&CodeMem.Mem[addr & CodeMem.Mask];
+
         return BusRead16(addr);
     }
 
     u32 CodeRead32(u32 addr)
     {
+        if (CodeMem.Mem) return *(u32*)&CodeMem.Mem[addr & CodeMem.Mask];
+
         return BusRead32(addr);
     }
 
@@ -334,7 +412,7 @@ public:
     {
         *val = BusRead8(addr);
         DataRegion = addr;
-        DataCycles = NDS::ARM7MemTimings[addr >> 15][0];
+        DataCycles = NDS::ARM7MemTimings(addr >> 15)[0];
     }
 
     void DataRead16(u32 addr, u32* val)
@@ -343,7 +421,7 @@ public:
 
         *val = BusRead16(addr);
         DataRegion = addr;
-        DataCycles = NDS::ARM7MemTimings[addr >> 15][0];
+        DataCycles = NDS::ARM7MemTimings(addr >> 15)[0];
     }
 
     void DataRead32(u32 addr, u32* val)
@@ -352,7 +430,7 @@ public:
 
         *val = BusRead32(addr);
         DataRegion = addr;
-        DataCycles = NDS::ARM7MemTimings[addr >> 15][2];
+        DataCycles = NDS::ARM7MemTimings(addr >> 15)[2];
     }
 
     void DataRead32S(u32 addr, u32* val)
@@ -360,14 +438,14 @@ public:
         addr &= ~3;
 
         *val = BusRead32(addr);
-        DataCycles += NDS::ARM7MemTimings[addr >> 15][3];
+        DataCycles += NDS::ARM7MemTimings(addr >> 15)[3];
     }
 
     void DataWrite8(u32 addr, u8 val)
     {
         BusWrite8(addr, val);
         DataRegion = addr;
-        DataCycles = NDS::ARM7MemTimings[addr >> 15][0];
+        DataCycles = NDS::ARM7MemTimings(addr >> 15)[0];
     }
 
     void DataWrite16(u32 addr, u16 val)
@@ -376,7 +454,7 @@ public:
 
         BusWrite16(addr, val);
         DataRegion = addr;
-        DataCycles = NDS::ARM7MemTimings[addr >> 15][0];
+        DataCycles = NDS::ARM7MemTimings(addr >> 15)[0];
     }
 
     void DataWrite32(u32 addr, u32 val)
@@ -385,7 +463,7 @@ public:
 
         BusWrite32(addr, val);
         DataRegion = addr;
-        DataCycles = NDS::ARM7MemTimings[addr >> 15][2];
+        DataCycles = NDS::ARM7MemTimings(addr >> 15)[2];
     }
 
     void DataWrite32S(u32 addr, u32 val)
@@ -393,26 +471,26 @@ public:
         addr &= ~3;
 
         BusWrite32(addr, val);
-        DataCycles += NDS::ARM7MemTimings[addr >> 15][3];
+        DataCycles += NDS::ARM7MemTimings(addr >> 15)[3];
     }
 
 
     void AddCycles_C()
     {
         // code only. this code fetch is sequential.
-        Cycles += NDS::ARM7MemTimings[CodeCycles][(CPSR&0x20)?1:3];
+        Cycles += NDS::ARM7MemTimings(CodeCycles)[(CPSR&0x20)?1:3];
     }
 
     void AddCycles_CI(s32 num)
     {
         // code+internal. results in a nonseq code fetch.
-        Cycles += NDS::ARM7MemTimings[CodeCycles][(CPSR&0x20)?0:2] + num;
+        Cycles += NDS::ARM7MemTimings(CodeCycles)[(CPSR&0x20)?0:2] + num;
     }
 
     void AddCycles_CDI()
     {
         // LDR/LDM cycles.
-        s32 numC = NDS::ARM7MemTimings[CodeCycles][(CPSR&0x20)?0:2];
+        s32 numC = NDS::ARM7MemTimings(CodeCycles)[(CPSR&0x20)?0:2];
         s32 numD = DataCycles;
 
         if ((DataRegion >> 24) == 0x02) // mainRAM
@@ -439,7 +517,7 @@ public:
     void AddCycles_CD()
     {
         // TODO: max gain should be 5c when writing to mainRAM
-        s32 numC = NDS::ARM7MemTimings[CodeCycles][(CPSR&0x20)?0:2];
+        s32 numC = NDS::ARM7MemTimings(CodeCycles)[(CPSR&0x20)?0:2];
         s32 numD = DataCycles;
 
         if ((DataRegion >> 24) == 0x02)
@@ -458,6 +536,8 @@ public:
             Cycles += numC + numD;
         }
     }
+
+    bool (*GetMemRegion)(u32 addr, bool write, NDS::MemRegion* region);
 };
 
 namespace ARMInterpreter
@@ -33,6 +33,7 @@ void A_UNK(ARM* cpu)
     printf("undefined ARM%d instruction %08X @ %08X\n", cpu->Num?7:9, cpu->CurInstr, cpu->R[15]-8);
     //for (int i = 0; i < 16; i++) printf("R%d: %08X\n", i, cpu->R[i]);
     //NDS::Halt();
+    cpu->MaterializeFlags();
     u32 oldcpsr = cpu->CPSR;
     cpu->CPSR &= ~0xBF;
     cpu->CPSR |= 0x9B;
@@ -47,6 +48,7 @@ void T_UNK(ARM* cpu)
 {
     printf("undefined THUMB%d instruction %04X @ %08X\n", cpu->Num?7:9, cpu->CurInstr, cpu->R[15]-4);
     //NDS::Halt();
+    cpu->MaterializeFlags();
     u32 oldcpsr = cpu->CPSR;
     cpu->CPSR &= ~0xBF;
     cpu->CPSR |= 0x9B;
@@ -61,6 +63,8 @@ void T_UNK(ARM* cpu)
 
 void A_MSR_IMM(ARM* cpu)
 {
+    cpu->MaterializeFlags();
+
     u32* psr;
     if (cpu->CurInstr & (1<<22))
     {
@@ -114,6 +118,8 @@ void A_MSR_IMM(ARM* cpu)
 
 void A_MSR_REG(ARM* cpu)
 {
+    cpu->MaterializeFlags();
+
     u32* psr;
     if (cpu->CurInstr & (1<<22))
     {
@@ -167,6 +173,8 @@ void A_MSR_REG(ARM* cpu)
 
 void A_MRS(ARM* cpu)
 {
+    cpu->MaterializeFlags();
+
     u32 psr;
     if (cpu->CurInstr & (1<<22))
     {
@@ -254,6 +262,7 @@ void A_MRC(ARM* cpu)
 
 void A_SVC(ARM* cpu)
 {
+    cpu->MaterializeFlags();
     u32 oldcpsr = cpu->CPSR;
     cpu->CPSR &= ~0xBF;
     cpu->CPSR |= 0x93;
@@ -266,6 +275,7 @@ void A_SVC(ARM* cpu)
 
 void T_SVC(ARM* cpu)
 {
+    cpu->MaterializeFlags();
     u32 oldcpsr = cpu->CPSR;
     cpu->CPSR &= ~0xBF;
     cpu->CPSR |= 0x93;
@@ -39,6 +39,11 @@ void T_SVC(ARM* cpu);
 
 void A_BLX_IMM(ARM* cpu); // I'm a special one look at me
 
+#if defined(THREADED_INTERP_ENABLED) && defined(__GNUC__)
+void ExecuteThreaded(ARMv5* cpu);
+void ExecuteThreaded(ARMv4* cpu);
+#endif
+
 }
 
 #endif // ARMINTERPRETER_H
@@ -45,6 +45,7 @@ namespace ARMInterpreter
 #define ROR_IMM(x, s) \
     if (s == 0) \
     { \
+        cpu->MaterializeFlags(); \
         x = (x >> 1) | ((cpu->CPSR & 0x20000000) << 2); \
     } \
     else \
@@ -81,6 +82,7 @@ namespace ARMInterpreter
     if (s == 0) \
     { \
         u32 newc = (x & 1); \
+        cpu->MaterializeFlags(); \
         x = (x >> 1) | ((cpu->CPSR & 0x20000000) << 2); \
         cpu->SetC(newc); \
     } \
@@ -300,8 +302,7 @@ void A_##x##_REG_ROR_REG(ARM* cpu) \
 #define A_AND_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a & b; \
-    cpu->SetNZ(res & 0x80000000, \
-               !res); \
+    cpu->SetNZLazy(res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -331,8 +332,7 @@ A_IMPLEMENT_ALU_OP(AND,_S)
 #define A_EOR_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a ^ b; \
-    cpu->SetNZ(res & 0x80000000, \
-               !res); \
+    cpu->SetNZLazy(res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -362,10 +362,7 @@ A_IMPLEMENT_ALU_OP(EOR,_S)
 #define A_SUB_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a - b; \
-    cpu->SetNZCV(res & 0x80000000, \
-                 !res, \
-                 CARRY_SUB(a, b), \
-                 OVERFLOW_SUB(a, b, res)); \
+    cpu->SetNZCVSubLazy(a, b, res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -395,10 +392,7 @@ A_IMPLEMENT_ALU_OP(SUB,)
 #define A_RSB_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = b - a; \
-    cpu->SetNZCV(res & 0x80000000, \
-                 !res, \
-                 CARRY_SUB(b, a), \
-                 OVERFLOW_SUB(b, a, res)); \
+    cpu->SetNZCVSubLazy(b, a, res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -428,10 +422,7 @@ A_IMPLEMENT_ALU_OP(RSB,)
 #define A_ADD_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a + b; \
-    cpu->SetNZCV(res & 0x80000000, \
-                 !res, \
-                 CARRY_ADD(a, b), \
-                 OVERFLOW_ADD(a, b, res)); \
+    cpu->SetNZCVAddLazy(a, b, res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -447,6 +438,7 @@ A_IMPLEMENT_ALU_OP(ADD,)
 
 #define A_ADC(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
+    cpu->MaterializeFlags(); \
     u32 res = a + b + (cpu->CPSR&0x20000000 ? 1:0); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
@@ -461,6 +453,7 @@ A_IMPLEMENT_ALU_OP(ADD,)
 #define A_ADC_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res_tmp = a + b; \
+    cpu->MaterializeFlags(); \
     u32 carry = (cpu->CPSR&0x20000000 ? 1:0); \
     u32 res = res_tmp + carry; \
     cpu->SetNZCV(res & 0x80000000, \
@@ -482,6 +475,7 @@ A_IMPLEMENT_ALU_OP(ADC,)
 
 #define A_SBC(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
+    cpu->MaterializeFlags(); \
     u32 res = a - b - (cpu->CPSR&0x20000000 ? 0:1); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
@@ -496,6 +490,7 @@ A_IMPLEMENT_ALU_OP(ADC,)
 #define A_SBC_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res_tmp = a - b; \
+    cpu->MaterializeFlags(); \
     u32 carry = (cpu->CPSR&0x20000000 ? 0:1); \
     u32 res = res_tmp - carry; \
     cpu->SetNZCV(res & 0x80000000, \
@@ -517,6 +512,7 @@ A_IMPLEMENT_ALU_OP(SBC,)
 
 #define A_RSC(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
+    cpu->MaterializeFlags(); \
     u32 res = b - a - (cpu->CPSR&0x20000000 ? 0:1); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
@@ -531,6 +527,7 @@ A_IMPLEMENT_ALU_OP(SBC,)
 #define A_RSC_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res_tmp = b - a; \
+    cpu->MaterializeFlags(); \
     u32 carry = (cpu->CPSR&0x20000000 ? 0:1); \
     u32 res = res_tmp - carry; \
     cpu->SetNZCV(res & 0x80000000, \
@@ -553,8 +550,7 @@ A_IMPLEMENT_ALU_OP(RSC,)
 #define A_TST(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a & b; \
-    cpu->SetNZ(res & 0x80000000, \
-               !res); \
+    cpu->SetNZLazy(res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C();
 
 A_IMPLEMENT_ALU_TEST(TST,_S)
@@ -563,8 +559,7 @@ A_IMPLEMENT_ALU_TEST(TST,_S)
 #define A_TEQ(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a ^ b; \
-    cpu->SetNZ(res & 0x80000000, \
-               !res); \
+    cpu->SetNZLazy(res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C();
 
 A_IMPLEMENT_ALU_TEST(TEQ,_S)
@@ -573,10 +568,7 @@ A_IMPLEMENT_ALU_TEST(TEQ,_S)
 #define A_CMP(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a - b; \
-    cpu->SetNZCV(res & 0x80000000, \
-                 !res, \
-                 CARRY_SUB(a, b), \
-                 OVERFLOW_SUB(a, b, res)); \
+    cpu->SetNZCVSubLazy(a, b, res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C();
 
 A_IMPLEMENT_ALU_TEST(CMP,)
@@ -585,10 +577,7 @@ A_IMPLEMENT_ALU_TEST(CMP,)
 #define A_CMN(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a + b; \
-    cpu->SetNZCV(res & 0x80000000, \
-                 !res, \
-                 CARRY_ADD(a, b), \
-                 OVERFLOW_ADD(a, b, res)); \
+    cpu->SetNZCVAddLazy(a, b, res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C();
 
 A_IMPLEMENT_ALU_TEST(CMN,)
@@ -610,8 +599,7 @@ A_IMPLEMENT_ALU_TEST(CMN,)
 #define A_ORR_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a | b; \
-    cpu->SetNZ(res & 0x80000000, \
-               !res); \
+    cpu->SetNZLazy(res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -637,8 +625,7 @@ A_IMPLEMENT_ALU_OP(ORR,_S)
     }
 
 #define A_MOV_S(c) \
-    cpu->SetNZ(b & 0x80000000, \
-               !b); \
+    cpu->SetNZLazy(b); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -686,8 +673,7 @@ void A_MOV_REG_LSL_IMM_DBG(ARM* cpu)
 #define A_BIC_S(c) \
     u32 a = cpu->R[(cpu->CurInstr>>16) & 0xF]; \
     u32 res = a & ~b; \
-    cpu->SetNZ(res & 0x80000000, \
-               !res); \
+    cpu->SetNZLazy(res); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -715,8 +701,7 @@ A_IMPLEMENT_ALU_OP(BIC,_S)
 
 #define A_MVN_S(c) \
     b = ~b; \
-    cpu->SetNZ(b & 0x80000000, \
-               !b); \
+    cpu->SetNZLazy(b); \
     if (c) cpu->AddCycles_CI(c); else cpu->AddCycles_C(); \
     if (((cpu->CurInstr>>12) & 0xF) == 15) \
     { \
@@ -741,8 +726,7 @@ void A_MUL(ARM* cpu)
     cpu->R[(cpu->CurInstr >> 16) & 0xF] = res;
     if (cpu->CurInstr & (1<<20))
     {
-        cpu->SetNZ(res & 0x80000000,
-                   !res);
+        cpu->SetNZLazy(res);
         if (cpu->Num==1) cpu->SetC(0);
     }
 
@@ -771,8 +755,7 @@ void A_MLA(ARM* cpu)
     cpu->R[(cpu->CurInstr >> 16) & 0xF] = res;
     if (cpu->CurInstr & (1<<20))
     {
-        cpu->SetNZ(res & 0x80000000,
-                   !res);
+        cpu->SetNZLazy(res);
         if (cpu->Num==1) cpu->SetC(0);
     }
 
@@ -1143,8 +1126,7 @@ void T_LSL_IMM(ARM* cpu)
     u32 s = (cpu->CurInstr >> 6) & 0x1F;
     LSL_IMM_S(op, s);
     cpu->R[cpu->CurInstr & 0x7] = op;
-    cpu->SetNZ(op & 0x80000000,
-               !op);
+    cpu->SetNZLazy(op);
     cpu->AddCycles_C();
 }
 
@@ -1154,8 +1136,7 @@ void T_LSR_IMM(ARM* cpu)
     u32 s = (cpu->CurInstr >> 6) & 0x1F;
     LSR_IMM_S(op, s);
     cpu->R[cpu->CurInstr & 0x7] = op;
-    cpu->SetNZ(op & 0x80000000,
-               !op);
+    cpu->SetNZLazy(op);
     cpu->AddCycles_C();
 }
 
@@ -1165,8 +1146,7 @@ void T_ASR_IMM(ARM* cpu)
     u32 s = (cpu->CurInstr >> 6) & 0x1F;
     ASR_IMM_S(op, s);
     cpu->R[cpu->CurInstr & 0x7] = op;
-    cpu->SetNZ(op & 0x80000000,
-               !op);
+    cpu->SetNZLazy(op);
     cpu->AddCycles_C();
 }
 
@@ -1176,10 +1156,7 @@ void T_ADD_REG_(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 6) & 0x7];
     u32 res = a + b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_ADD(a, b),
-                 OVERFLOW_ADD(a, b, res));
+    cpu->SetNZCVAddLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1189,10 +1166,7 @@ void T_SUB_REG_(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 6) & 0x7];
     u32 res = a - b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_SUB(a, b),
-                 OVERFLOW_SUB(a, b, res));
+    cpu->SetNZCVSubLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1202,10 +1176,7 @@ void T_ADD_IMM_(ARM* cpu)
     u32 b = (cpu->CurInstr >> 6) & 0x7;
     u32 res = a + b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_ADD(a, b),
-                 OVERFLOW_ADD(a, b, res));
+    cpu->SetNZCVAddLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1215,10 +1186,7 @@ void T_SUB_IMM_(ARM* cpu)
     u32 b = (cpu->CurInstr >> 6) & 0x7;
     u32 res = a - b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_SUB(a, b),
-                 OVERFLOW_SUB(a, b, res));
+    cpu->SetNZCVSubLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1226,8 +1194,7 @@ void T_MOV_IMM(ARM* cpu)
 {
     u32 b = cpu->CurInstr & 0xFF;
     cpu->R[(cpu->CurInstr >> 8) & 0x7] = b;
-    cpu->SetNZ(0,
-               !b);
+    cpu->SetNZLazy(b);
     cpu->AddCycles_C();
 }
 
@@ -1236,10 +1203,7 @@ void T_CMP_IMM(ARM* cpu)
     u32 a = cpu->R[(cpu->CurInstr >> 8) & 0x7];
     u32 b = cpu->CurInstr & 0xFF;
     u32 res = a - b;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_SUB(a, b),
-                 OVERFLOW_SUB(a, b, res));
+    cpu->SetNZCVSubLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1249,10 +1213,7 @@ void T_ADD_IMM(ARM* cpu)
     u32 b = cpu->CurInstr & 0xFF;
     u32 res = a + b;
     cpu->R[(cpu->CurInstr >> 8) & 0x7] = res;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_ADD(a, b),
-                 OVERFLOW_ADD(a, b, res));
+    cpu->SetNZCVAddLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1262,10 +1223,7 @@ void T_SUB_IMM(ARM* cpu)
     u32 b = cpu->CurInstr & 0xFF;
     u32 res = a - b;
     cpu->R[(cpu->CurInstr >> 8) & 0x7] = res;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_SUB(a, b),
-                 OVERFLOW_SUB(a, b, res));
+    cpu->SetNZCVSubLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1276,8 +1234,7 @@ void T_AND_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a & b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZ(res & 0x80000000,
-               !res);
+    cpu->SetNZLazy(res);
     cpu->AddCycles_C();
 }
 
@@ -1287,8 +1244,7 @@ void T_EOR_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a ^ b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZ(res & 0x80000000,
-               !res);
+    cpu->SetNZLazy(res);
     cpu->AddCycles_C();
 }
 
@@ -1298,8 +1254,7 @@ void T_LSL_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7] & 0xFF;
     LSL_REG_S(a, b);
     cpu->R[cpu->CurInstr & 0x7] = a;
-    cpu->SetNZ(a & 0x80000000,
-               !a);
+    cpu->SetNZLazy(a);
     cpu->AddCycles_CI(1);
 }
 
@@ -1309,8 +1264,7 @@ void T_LSR_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7] & 0xFF;
     LSR_REG_S(a, b);
     cpu->R[cpu->CurInstr & 0x7] = a;
-    cpu->SetNZ(a & 0x80000000,
-               !a);
+    cpu->SetNZLazy(a);
     cpu->AddCycles_CI(1);
 }
 
@@ -1320,8 +1274,7 @@ void T_ASR_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7] & 0xFF;
     ASR_REG_S(a, b);
     cpu->R[cpu->CurInstr & 0x7] = a;
-    cpu->SetNZ(a & 0x80000000,
-               !a);
+    cpu->SetNZLazy(a);
     cpu->AddCycles_CI(1);
 }
 
@@ -1330,6 +1283,7 @@ void T_ADC_REG(ARM* cpu)
     u32 a = cpu->R[cpu->CurInstr & 0x7];
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res_tmp = a + b;
+    cpu->MaterializeFlags();
     u32 carry = (cpu->CPSR&0x20000000 ? 1:0);
     u32 res = res_tmp + carry;
     cpu->R[cpu->CurInstr & 0x7] = res;
@@ -1345,6 +1299,7 @@ void T_SBC_REG(ARM* cpu)
     u32 a = cpu->R[cpu->CurInstr & 0x7];
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res_tmp = a - b;
+    cpu->MaterializeFlags();
     u32 carry = (cpu->CPSR&0x20000000 ? 0:1);
     u32 res = res_tmp - carry;
     cpu->R[cpu->CurInstr & 0x7] = res;
@@ -1361,8 +1316,7 @@ void T_ROR_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7] & 0xFF;
     ROR_REG_S(a, b);
     cpu->R[cpu->CurInstr & 0x7] = a;
-    cpu->SetNZ(a & 0x80000000,
-               !a);
+    cpu->SetNZLazy(a);
     cpu->AddCycles_CI(1);
 }
 
@@ -1371,8 +1325,7 @@ void T_TST_REG(ARM* cpu)
     u32 a = cpu->R[cpu->CurInstr & 0x7];
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a & b;
-    cpu->SetNZ(res & 0x80000000,
-               !res);
+    cpu->SetNZLazy(res);
     cpu->AddCycles_C();
 }
 
@@ -1381,10 +1334,7 @@ void T_NEG_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = -b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_SUB(0, b),
-                 OVERFLOW_SUB(0, b, res));
+    cpu->SetNZCVSubLazy(0, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1393,10 +1343,7 @@ void T_CMP_REG(ARM* cpu)
     u32 a = cpu->R[cpu->CurInstr & 0x7];
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a - b;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_SUB(a, b),
-                 OVERFLOW_SUB(a, b, res));
+    cpu->SetNZCVSubLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1405,10 +1352,7 @@ void T_CMN_REG(ARM* cpu)
     u32 a = cpu->R[cpu->CurInstr & 0x7];
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a + b;
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_ADD(a, b),
-                 OVERFLOW_ADD(a, b, res));
+    cpu->SetNZCVAddLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -1418,8 +1362,7 @@ void T_ORR_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a | b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZ(res & 0x80000000,
-               !res);
+    cpu->SetNZLazy(res);
     cpu->AddCycles_C();
 }
 
@@ -1429,8 +1372,7 @@ void T_MUL_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a * b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZ(res & 0x80000000,
-               !res);
+    cpu->SetNZLazy(res);
 
     s32 cycles = 0;
     if (cpu->Num == 0)
@@ -1454,8 +1396,7 @@ void T_BIC_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = a & ~b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZ(res & 0x80000000,
-               !res);
+    cpu->SetNZLazy(res);
     cpu->AddCycles_C();
 }
 
@@ -1464,8 +1405,7 @@ void T_MVN_REG(ARM* cpu)
     u32 b = cpu->R[(cpu->CurInstr >> 3) & 0x7];
     u32 res = ~b;
     cpu->R[cpu->CurInstr & 0x7] = res;
-    cpu->SetNZ(res & 0x80000000,
-               !res);
+    cpu->SetNZLazy(res);
     cpu->AddCycles_C();
 }
 
@@ -1502,10 +1442,7 @@ void T_CMP_HIREG(ARM* cpu)
     u32 b = cpu->R[rs];
     u32 res = a - b;
 
-    cpu->SetNZCV(res & 0x80000000,
-                 !res,
-                 CARRY_SUB(a, b),
-                 OVERFLOW_SUB(a, b, res));
+    cpu->SetNZCVSubLazy(a, b, res);
     cpu->AddCycles_C();
 }
 
@@ -39,6 +39,7 @@ namespace ARMInterpreter
 #define ROR_IMM(x, s) \
     if (s == 0) \
     { \
+        cpu->MaterializeFlags(); \
         x = (x >> 1) | ((cpu->CPSR & 0x20000000) << 2); \
     } \
     else \
@@ -0,0 +1,824 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#if defined(THREADED_INTERP_ENABLED) && defined(__GNUC__)
+
+#include <type_traits>
+
+#include "ARM.h"
+#include "ARMInterpreter.h"
+#include "ARMInterpreter_ALU.h"
+#include "ARMInterpreter_Branch.h"
+#include "ARMInterpreter_LoadStore.h"
+
+
+namespace ARMInterpreter
+{
+
+// the handlers below are copies of the ones in ARMInterpreter_ALU.cpp,
+// ARMInterpreter_LoadStore.cpp and ARMInterpreter_Branch.cpp,
+// keep them in sync. everything else goes through the function tables.
+//
+// each handler ends by fetching and jumping to the next instruction itself,
+// so every handler gets its own indirect branch to predict.
+// halting, idle loops and IRQs are only looked at after stores, branches
+// and the generic handlers, nothing else can start any of them (loads from
+// IO which raise an IRQ are picked up at the next boundary).
+
+#define THREADED_ADVANCE() \
+    timestamp += cpu->Cycles; \
+    cpu->Cycles = 0; \
+    if (timestamp >= target) return;
+
+#define THREADED_FETCH_THUMB() \
+    cpu->R[15] += 2; \
+    cpu->CurInstr = cpu->NextInstr[0]; \
+    cpu->NextInstr[0] = cpu->NextInstr[1]; \
+    if constexpr (v5) \
+    { \
+        if (cpu->R[15] & 0x2) { cpu->NextInstr[1] >>= 16; cpu->CodeCycles = 0; } \
+        else                  cpu->NextInstr[1] = cpu->CodeRead32(cpu->R[15], false); \
+    } \
+    else \
+        cpu->NextInstr[1] = cpu->CodeRead16(cpu->R[15]); \
+    goto *thumbLabels[(cpu->CurInstr >> 6) & 0x3FF];
+
+#define THREADED_FETCH_ARM() \
+    cpu->R[15] += 4; \
+    cpu->CurInstr = cpu->NextInstr[0]; \
+    cpu->NextInstr[0] = cpu->NextInstr[1]; \
+    if constexpr (v5) cpu->NextInstr[1] = cpu->CodeRead32(cpu->R[15], false); \
+    else              cpu->NextInstr[1] = cpu->CodeRead32(cpu->R[15]); \
+    if (cpu->CheckCondition(cpu->CurInstr >> 28)) \
+        goto *armLabels[((cpu->CurInstr >> 4) & 0xF) | ((cpu->CurInstr >> 16) & 0xFF0)]; \
+    goto arm_condfail;
+
+// the instruction can't have left THUMB/ARM state
+#define THUMB_NEXT() { THREADED_ADVANCE() THREADED_FETCH_THUMB() }
+#define ARM_NEXT()   { THREADED_ADVANCE() THREADED_FETCH_ARM() }
+
+// a data abort on the ARM9 switches to ARM state
+#define THUMB_NEXT_MEM() \
+    { \
+        if (v5 && !(cpu->CPSR & 0x20)) goto next; \
+        THUMB_NEXT() \
+    }
+
+#define THUMB_NEXT_CHECKED() \
+    { \
+        if (cpu->StopExecution) goto check; \
+        THUMB_NEXT_MEM() \
+    }
+
+#define ARM_NEXT_CHECKED() \
+    { \
+        if (cpu->StopExecution) goto check; \
+        ARM_NEXT() \
+    }
+
+#define THREADED_LABEL(table, fn, label) \
+    if (table[i] == fn) labels[i] = &&label;
+
+
+template <typename CPU>
+void ExecuteThreaded(CPU* cpu)
+{
+    constexpr bool v5 = std::is_same_v<CPU, ARMv5>;
+
+    u64& timestamp = v5 ? NDS::ARM9Timestamp : NDS::ARM7Timestamp;
+    u64& target = v5 ? NDS::ARM9Target : NDS::ARM7Target;
+
+    // label addresses only exist inside this function,
+    // so the tables are filled in the first time it runs
+    static void* armLabels[4096];
+    static void* thumbLabels[1024];
+    static bool labelsInited = false;
+
+    if (!labelsInited)
+    {
+        void** labels = armLabels;
+        for (u32 i = 0; i < 4096; i++)
+        {
+            labels[i] = &&arm_generic;
+
+            THREADED_LABEL(ARMInstrTable, A_MOV_IMM, a_mov_imm)
+            THREADED_LABEL(ARMInstrTable, A_MOV_REG_LSL_IMM, a_mov_reg_lsl_imm)
+            THREADED_LABEL(ARMInstrTable, A_MVN_IMM, a_mvn_imm)
+            THREADED_LABEL(ARMInstrTable, A_ADD_IMM, a_add_imm)
+            THREADED_LABEL(ARMInstrTable, A_ADD_REG_LSL_IMM, a_add_reg_lsl_imm)
+            THREADED_LABEL(ARMInstrTable, A_SUB_IMM, a_sub_imm)
+            THREADED_LABEL(ARMInstrTable, A_SUB_REG_LSL_IMM, a_sub_reg_lsl_imm)
+            THREADED_LABEL(ARMInstrTable, A_AND_IMM, a_and_imm)
+            THREADED_LABEL(ARMInstrTable, A_AND_REG_LSL_IMM, a_and_reg_lsl_imm)
+            THREADED_LABEL(ARMInstrTable, A_ORR_IMM, a_orr_imm)
+            THREADED_LABEL(ARMInstrTable, A_ORR_REG_LSL_IMM, a_orr_reg_lsl_imm)
+            THREADED_LABEL(ARMInstrTable, A_ADD_IMM_S, a_add_imm_s)
+            THREADED_LABEL(ARMInstrTable, A_SUB_IMM_S, a_sub_imm_s)
+            THREADED_LABEL(ARMInstrTable, A_CMP_IMM, a_cmp_imm)
+            THREADED_LABEL(ARMInstrTable, A_CMP_REG_LSL_IMM, a_cmp_reg_lsl_imm)
+            THREADED_LABEL(ARMInstrTable, A_TST_IMM, a_tst_imm)
+            THREADED_LABEL(ARMInstrTable, A_TST_REG_LSL_IMM, a_tst_reg_lsl_imm)
+
+            THREADED_LABEL(ARMInstrTable, A_LDR_IMM, a_ldr_imm)
+            THREADED_LABEL(ARMInstrTable, A_LDRB_IMM, a_ldrb_imm)
+            THREADED_LABEL(ARMInstrTable, A_STR_IMM, a_str_imm)
+            THREADED_LABEL(ARMInstrTable, A_STRB_IMM, a_strb_imm)
+
+            THREADED_LABEL(ARMInstrTable, A_B, a_b)
+            THREADED_LABEL(ARMInstrTable, A_BL, a_bl)
+        }
+
+        labels = thumbLabels;
+        for (u32 i = 0; i < 1024; i++)
+        {
+            labels[i] = &&thumb_generic;
+
+            THREADED_LABEL(THUMBInstrTable, T_LSL_IMM, t_lsl_imm)
+            THREADED_LABEL(THUMBInstrTable, T_LSR_IMM, t_lsr_imm)
+            THREADED_LABEL(THUMBInstrTable, T_ASR_IMM, t_asr_imm)
+            THREADED_LABEL(THUMBInstrTable, T_ADD_REG_, t_add_reg_)
+            THREADED_LABEL(THUMBInstrTable, T_SUB_REG_, t_sub_reg_)
+            THREADED_LABEL(THUMBInstrTable, T_ADD_IMM_, t_add_imm_)
+            THREADED_LABEL(THUMBInstrTable, T_SUB_IMM_, t_sub_imm_)
+            THREADED_LABEL(THUMBInstrTable, T_MOV_IMM, t_mov_imm)
+            THREADED_LABEL(THUMBInstrTable, T_CMP_IMM, t_cmp_imm)
+            THREADED_LABEL(THUMBInstrTable, T_ADD_IMM, t_add_imm)
+            THREADED_LABEL(THUMBInstrTable, T_SUB_IMM, t_sub_imm)
+            THREADED_LABEL(THUMBInstrTable, T_AND_REG, t_and_reg)
+            THREADED_LABEL(THUMBInstrTable, T_EOR_REG, t_eor_reg)
+            THREADED_LABEL(THUMBInstrTable, T_LSL_REG, t_lsl_reg)
+            THREADED_LABEL(THUMBInstrTable, T_LSR_REG, t_lsr_reg)
+            THREADED_LABEL(THUMBInstrTable, T_TST_REG, t_tst_reg)
+            THREADED_LABEL(THUMBInstrTable, T_NEG_REG, t_neg_reg)
+            THREADED_LABEL(THUMBInstrTable, T_CMP_REG, t_cmp_reg)
+            THREADED_LABEL(THUMBInstrTable, T_ORR_REG, t_orr_reg)
+            THREADED_LABEL(THUMBInstrTable, T_BIC_REG, t_bic_reg)
+            THREADED_LABEL(THUMBInstrTable, T_MVN_REG, t_mvn_reg)
+            THREADED_LABEL(THUMBInstrTable, T_ADD_HIREG, t_add_hireg)
+            THREADED_LABEL(THUMBInstrTable, T_CMP_HIREG, t_cmp_hireg)
+            THREADED_LABEL(THUMBInstrTable, T_MOV_HIREG, t_mov_hireg)
+            THREADED_LABEL(THUMBInstrTable, T_ADD_PCREL, t_add_pcrel)
+            THREADED_LABEL(THUMBInstrTable, T_ADD_SPREL, t_add_sprel)
+            THREADED_LABEL(THUMBInstrTable, T_ADD_SP, t_add_sp)
+
+            THREADED_LABEL(THUMBInstrTable, T_LDR_PCREL, t_ldr_pcrel)
+            THREADED_LABEL(THUMBInstrTable, T_LDR_REG, t_ldr_reg)
+            THREADED_LABEL(THUMBInstrTable, T_LDRB_REG, t_ldrb_reg)
+            THREADED_LABEL(THUMBInstrTable, T_LDRH_REG, t_ldrh_reg)
+            THREADED_LABEL(THUMBInstrTable, T_LDR_IMM, t_ldr_imm)
+            THREADED_LABEL(THUMBInstrTable, T_LDRB_IMM, t_ldrb_imm)
+            THREADED_LABEL(THUMBInstrTable, T_LDRH_IMM, t_ldrh_imm)
+            THREADED_LABEL(THUMBInstrTable, T_LDR_SPREL, t_ldr_sprel)
+            THREADED_LABEL(THUMBInstrTable, T_STR_REG, t_str_reg)
+            THREADED_LABEL(THUMBInstrTable, T_STRB_REG, t_strb_reg)
+            THREADED_LABEL(THUMBInstrTable, T_STR_IMM, t_str_imm)
+            THREADED_LABEL(THUMBInstrTable, T_STRB_IMM, t_strb_imm)
+            THREADED_LABEL(THUMBInstrTable, T_STRH_IMM, t_strh_imm)
+            THREADED_LABEL(THUMBInstrTable, T_STR_SPREL, t_str_sprel)
+
+            THREADED_LABEL(THUMBInstrTable, T_BCOND, t_bcond)
+            THREADED_LABEL(THUMBInstrTable, T_B, t_b)
+            THREADED_LABEL(THUMBInstrTable, T_BL_LONG_1, t_bl_long_1)
+            THREADED_LABEL(THUMBInstrTable, T_BL_LONG_2, t_bl_long_2)
+        }
+
+        labelsInited = true;
+    }
+
+    goto dispatch;
+
+check:
+    if (cpu->StopExecution)
+    {
+        if (cpu->Halted)
+        {
+            if (cpu->Halted == 1 && timestamp < target)
+            {
+                timestamp = target;
+            }
+            return;
+        }
+        if (cpu->IdleLoop)
+        {
+            // nothing is going to change until the next event
+            // unless there's an IRQ to take
+            cpu->IdleLoop = 0;
+            if (!cpu->IRQ || (cpu->CPSR & 0x80))
+            {
+                cpu->Cycles = 0;
+                timestamp = target;
+                return;
+            }
+        }
+        if (cpu->IRQ) cpu->TriggerIRQ();
+    }
+next:
+    timestamp += cpu->Cycles;
+    cpu->Cycles = 0;
+dispatch:
+    if (timestamp >= target) return;
+    if (cpu->CPSR & 0x20)
+    {
+        THREADED_FETCH_THUMB()
+    }
+    else
+    {
+        THREADED_FETCH_ARM()
+    }
+
+arm_condfail:
+    if (v5 && (cpu->CurInstr & 0xFE000000) == 0xFA000000)
+    {
+        A_BLX_IMM(cpu);
+        goto check;
+    }
+    cpu->AddCycles_C();
+    ARM_NEXT()
+
+arm_generic:
+    {
+        u32 instrAddr = cpu->R[15] - 8;
+        ARMInstrTable[((cpu->CurInstr >> 4) & 0xF) | ((cpu->CurInstr >> 16) & 0xFF0)](cpu);
+        cpu->CheckIdleLoop(false, instrAddr);
+        goto check;
+    }
+
+thumb_generic:
+    {
+        u32 instrAddr = cpu->R[15] - 4;
+        THUMBInstrTable[(cpu->CurInstr >> 6) & 0x3FF](cpu);
+        cpu->CheckIdleLoop(true, instrAddr);
+        goto check;
+    }
+
+    // ARM data processing, Rd=15 goes through the tables
+
+#define A_THREADED_OP2_IMM \
+    ROR(cur & 0xFF, (cur >> 7) & 0x1E)
+#define A_THREADED_OP2_REG_LSL_IMM \
+    (cpu->R[cur & 0xF] << ((cur >> 7) & 0x1F))
+#define A_THREADED_RN \
+    cpu->R[(cur >> 16) & 0xF]
+
+#define A_THREADED_ALU(label, res) \
+label: \
+    { \
+        u32 cur = cpu->CurInstr; \
+        if (((cur >> 12) & 0xF) == 15) goto arm_generic; \
+        cpu->R[(cur >> 12) & 0xF] = res; \
+        cpu->AddCycles_C(); \
+        ARM_NEXT() \
+    }
+
+    A_THREADED_ALU(a_mov_imm, A_THREADED_OP2_IMM)
+    A_THREADED_ALU(a_mov_reg_lsl_imm, A_THREADED_OP2_REG_LSL_IMM)
+    A_THREADED_ALU(a_mvn_imm, ~A_THREADED_OP2_IMM)
+    A_THREADED_ALU(a_add_imm, A_THREADED_RN + A_THREADED_OP2_IMM)
+    A_THREADED_ALU(a_add_reg_lsl_imm, A_THREADED_RN + A_THREADED_OP2_REG_LSL_IMM)
+    A_THREADED_ALU(a_sub_imm, A_THREADED_RN - A_THREADED_OP2_IMM)
+    A_THREADED_ALU(a_sub_reg_lsl_imm, A_THREADED_RN - A_THREADED_OP2_REG_LSL_IMM)
+    A_THREADED_ALU(a_and_imm, A_THREADED_RN & A_THREADED_OP2_IMM)
+    A_THREADED_ALU(a_and_reg_lsl_imm, A_THREADED_RN & A_THREADED_OP2_REG_LSL_IMM)
+    A_THREADED_ALU(a_orr_imm, A_THREADED_RN | A_THREADED_OP2_IMM)
+    A_THREADED_ALU(a_orr_reg_lsl_imm, A_THREADED_RN | A_THREADED_OP2_REG_LSL_IMM)
+
+a_add_imm_s:
+    {
+        u32 cur = cpu->CurInstr;
+        if (((cur >> 12) & 0xF) == 15) goto arm_generic;
+        u32 a = A_THREADED_RN;
+        u32 b = A_THREADED_OP2_IMM;
+        u32 res = a + b;
+        cpu->SetNZCVAddLazy(a, b, res);
+        cpu->AddCycles_C();
+        cpu->R[(cur >> 12) & 0xF] = res;
+        ARM_NEXT()
+    }
+
+a_sub_imm_s:
+    {
+        u32 cur = cpu->CurInstr;
+        if (((cur >> 12) & 0xF) == 15) goto arm_generic;
+        u32 a = A_THREADED_RN;
+        u32 b = A_THREADED_OP2_IMM;
+        u32 res = a - b;
+        cpu->SetNZCVSubLazy(a, b, res);
+        cpu->AddCycles_C();
+        cpu->R[(cur >> 12) & 0xF] = res;
+        ARM_NEXT()
+    }
+
+a_cmp_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 a = A_THREADED_RN;
+        u32 b = A_THREADED_OP2_IMM;
+        u32 res = a - b;
+        cpu->SetNZCVSubLazy(a, b, res);
+        cpu->AddCycles_C();
+        ARM_NEXT()
+    }
+
+a_cmp_reg_lsl_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 a = A_THREADED_RN;
+        u32 b = A_THREADED_OP2_REG_LSL_IMM;
+        u32 res = a - b;
+        cpu->SetNZCVSubLazy(a, b, res);
+        cpu->AddCycles_C();
+        ARM_NEXT()
+    }
+
+a_tst_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 b = A_THREADED_OP2_IMM;
+        if ((cur >> 7) & 0x1E)
+            cpu->SetC(b & 0x80000000);
+        u32 res = A_THREADED_RN & b;
+        cpu->SetNZLazy(res);
+        cpu->AddCycles_C();
+        ARM_NEXT()
+    }
+
+a_tst_reg_lsl_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 b = cpu->R[cur & 0xF];
+        u32 s = (cur >> 7) & 0x1F;
+        if (s > 0)
+        {
+            cpu->SetC(b & (1<<(32-s)));
+            b <<= s;
+        }
+        u32 res = A_THREADED_RN & b;
+        cpu->SetNZLazy(res);
+        cpu->AddCycles_C();
+        ARM_NEXT()
+    }
+
+    // ARM single data transfers, immediate offset, pre-indexed
+
+a_ldr_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        if (((cur >> 12) & 0xF) == 15) goto arm_generic;
+        u32 offset = cur & 0xFFF;
+        if (!(cur & (1<<23))) offset = -offset;
+        offset += A_THREADED_RN;
+        u32 val; cpu->DataRead32(offset, &val);
+        val = ROR(val, ((offset&0x3)<<3));
+        if (cur & (1<<21)) A_THREADED_RN = offset;
+        cpu->AddCycles_CDI();
+        cpu->R[(cur >> 12) & 0xF] = val;
+        ARM_NEXT()
+    }
+
+a_ldrb_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        if (((cur >> 12) & 0xF) == 15) goto arm_generic;
+        u32 offset = cur & 0xFFF;
+        if (!(cur & (1<<23))) offset = -offset;
+        offset += A_THREADED_RN;
+        u32 val; cpu->DataRead8(offset, &val);
+        if (cur & (1<<21)) A_THREADED_RN = offset;
+        cpu->AddCycles_CDI();
+        cpu->R[(cur >> 12) & 0xF] = val;
+        ARM_NEXT()
+    }
+
+a_str_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = cur & 0xFFF;
+        if (!(cur & (1<<23))) offset = -offset;
+        offset += A_THREADED_RN;
+        cpu->DataWrite32(offset, cpu->R[(cur >> 12) & 0xF]);
+        if (cur & (1<<21)) A_THREADED_RN = offset;
+        cpu->AddCycles_CD();
+        ARM_NEXT_CHECKED()
+    }
+
+a_strb_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = cur & 0xFFF;
+        if (!(cur & (1<<23))) offset = -offset;
+        offset += A_THREADED_RN;
+        cpu->DataWrite8(offset, cpu->R[(cur >> 12) & 0xF]);
+        if (cur & (1<<21)) A_THREADED_RN = offset;
+        cpu->AddCycles_CD();
+        ARM_NEXT_CHECKED()
+    }
+
+    // ARM branches
+
+a_b:
+    {
+        u32 instrAddr = cpu->R[15] - 8;
+        s32 offset = (s32)(cpu->CurInstr << 8) >> 6;
+        cpu->JumpTo(cpu->R[15] + offset);
+        cpu->CheckIdleLoop(false, instrAddr);
+        ARM_NEXT_CHECKED()
+    }
+
+a_bl:
+    {
+        u32 instrAddr = cpu->R[15] - 8;
+        s32 offset = (s32)(cpu->CurInstr << 8) >> 6;
+        cpu->R[14] = cpu->R[15] - 4;
+        cpu->JumpTo(cpu->R[15] + offset);
+        cpu->CheckIdleLoop(false, instrAddr);
+        ARM_NEXT_CHECKED()
+    }
+
+    // THUMB shifts and ALU operations
+
+#define T_THREADED_SHIFT_IMM(label, shift) \
+label: \
+    { \
+        u32 cur = cpu->CurInstr; \
+        u32 op = cpu->R[(cur >> 3) & 0x7]; \
+        u32 s = (cur >> 6) & 0x1F; \
+        shift \
+        cpu->R[cur & 0x7] = op; \
+        cpu->SetNZLazy(op); \
+        cpu->AddCycles_C(); \
+        THUMB_NEXT() \
+    }
+
+    T_THREADED_SHIFT_IMM(t_lsl_imm,
+        if (s > 0) { cpu->SetC(op & (1<<(32-s))); op <<= s; })
+    T_THREADED_SHIFT_IMM(t_lsr_imm,
+        if (s == 0) { cpu->SetC(op & (1<<31)); op = 0; }
+        else        { cpu->SetC(op & (1<<(s-1))); op >>= s; })
+    T_THREADED_SHIFT_IMM(t_asr_imm,
+        if (s == 0) { cpu->SetC(op & (1<<31)); op = ((s32)op) >> 31; }
+        else        { cpu->SetC(op & (1<<(s-1))); op = ((s32)op) >> s; })
+
+#define T_THREADED_ADDSUB(label, a, b, rd, op, setflags) \
+label: \
+    { \
+        u32 cur = cpu->CurInstr; \
+        u32 va = a; \
+        u32 vb = b; \
+        u32 res = va op vb; \
+        cpu->R[rd] = res; \
+        cpu->setflags(va, vb, res); \
+        cpu->AddCycles_C(); \
+        THUMB_NEXT() \
+    }
+
+    T_THREADED_ADDSUB(t_add_reg_, cpu->R[(cur >> 3) & 0x7], cpu->R[(cur >> 6) & 0x7], cur & 0x7, +, SetNZCVAddLazy)
+    T_THREADED_ADDSUB(t_sub_reg_, cpu->R[(cur >> 3) & 0x7], cpu->R[(cur >> 6) & 0x7], cur & 0x7, -, SetNZCVSubLazy)
+    T_THREADED_ADDSUB(t_add_imm_, cpu->R[(cur >> 3) & 0x7], (cur >> 6) & 0x7, cur & 0x7, +, SetNZCVAddLazy)
+    T_THREADED_ADDSUB(t_sub_imm_, cpu->R[(cur >> 3) & 0x7], (cur >> 6) & 0x7, cur & 0x7, -, SetNZCVSubLazy)
+    T_THREADED_ADDSUB(t_add_imm, cpu->R[(cur >> 8) & 0x7], cur & 0xFF, (cur >> 8) & 0x7, +, SetNZCVAddLazy)
+    T_THREADED_ADDSUB(t_sub_imm, cpu->R[(cur >> 8) & 0x7], cur & 0xFF, (cur >> 8) & 0x7, -, SetNZCVSubLazy)
+    T_THREADED_ADDSUB(t_neg_reg, 0, cpu->R[(cur >> 3) & 0x7], cur & 0x7, -, SetNZCVSubLazy)
+
+t_mov_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 b = cur & 0xFF;
+        cpu->R[(cur >> 8) & 0x7] = b;
+        cpu->SetNZLazy(b);
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+#define T_THREADED_CMP(label, a, b) \
+label: \
+    { \
+        u32 cur = cpu->CurInstr; \
+        u32 va = a; \
+        u32 vb = b; \
+        u32 res = va - vb; \
+        cpu->SetNZCVSubLazy(va, vb, res); \
+        cpu->AddCycles_C(); \
+        THUMB_NEXT() \
+    }
+
+    T_THREADED_CMP(t_cmp_imm, cpu->R[(cur >> 8) & 0x7], cur & 0xFF)
+    T_THREADED_CMP(t_cmp_reg, cpu->R[cur & 0x7], cpu->R[(cur >> 3) & 0x7])
+    T_THREADED_CMP(t_cmp_hireg, cpu->R[(cur & 0x7) | ((cur >> 4) & 0x8)], cpu->R[(cur >> 3) & 0xF])
+
+#define T_THREADED_LOGIC(label, res, write) \
+label: \
+    { \
+        u32 cur = cpu->CurInstr; \
+        u32 a = cpu->R[cur & 0x7]; \
+        u32 b = cpu->R[(cur >> 3) & 0x7]; \
+        u32 r = res; \
+        if (write) cpu->R[cur & 0x7] = r; \
+        cpu->SetNZLazy(r); \
+        cpu->AddCycles_C(); \
+        THUMB_NEXT() \
+    }
+
+    T_THREADED_LOGIC(t_and_reg, a & b, true)
+    T_THREADED_LOGIC(t_eor_reg, a ^ b, true)
+    T_THREADED_LOGIC(t_tst_reg, a & b, false)
+    T_THREADED_LOGIC(t_orr_reg, a | b, true)
+    T_THREADED_LOGIC(t_bic_reg, a & ~b, true)
+
+t_mvn_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 res = ~cpu->R[(cur >> 3) & 0x7];
+        cpu->R[cur & 0x7] = res;
+        cpu->SetNZLazy(res);
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+t_lsl_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 a = cpu->R[cur & 0x7];
+        u32 s = cpu->R[(cur >> 3) & 0x7] & 0xFF;
+        if (s > 31)     { cpu->SetC((s>32) ? 0 : (a & (1<<0))); a = 0; }
+        else if (s > 0) { cpu->SetC(a & (1<<(32-s)));           a <<= s; }
+        cpu->R[cur & 0x7] = a;
+        cpu->SetNZLazy(a);
+        cpu->AddCycles_CI(1);
+        THUMB_NEXT()
+    }
+
+t_lsr_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 a = cpu->R[cur & 0x7];
+        u32 s = cpu->R[(cur >> 3) & 0x7] & 0xFF;
+        if (s > 31)     { cpu->SetC((s>32) ? 0 : (a & (1<<31))); a = 0; }
+        else if (s > 0) { cpu->SetC(a & (1<<(s-1)));             a >>= s; }
+        cpu->R[cur & 0x7] = a;
+        cpu->SetNZLazy(a);
+        cpu->AddCycles_CI(1);
+        THUMB_NEXT()
+    }
+
+    // high register operations, writes to PC and the nocash debug hook
+    // go through the tables
+
+t_add_hireg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 rd = (cur & 0x7) | ((cur >> 4) & 0x8);
+        if (rd == 15) goto thumb_generic;
+        cpu->R[rd] += cpu->R[(cur >> 3) & 0xF];
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+t_mov_hireg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 rd = (cur & 0x7) | ((cur >> 4) & 0x8);
+        if (rd == 15 || (cur & 0xFFFF) == 0x46E4) goto thumb_generic;
+        cpu->R[rd] = cpu->R[(cur >> 3) & 0xF];
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+t_add_pcrel:
+    {
+        u32 cur = cpu->CurInstr;
+        cpu->R[(cur >> 8) & 0x7] = (cpu->R[15] & ~2) + ((cur & 0xFF) << 2);
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+t_add_sprel:
+    {
+        u32 cur = cpu->CurInstr;
+        cpu->R[(cur >> 8) & 0x7] = cpu->R[13] + ((cur & 0xFF) << 2);
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+t_add_sp:
+    {
+        u32 cur = cpu->CurInstr;
+        if (cur & (1<<7))
+            cpu->R[13] -= ((cur & 0x7F) << 2);
+        else
+            cpu->R[13] += ((cur & 0x7F) << 2);
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+    // THUMB loads
+
+t_ldr_pcrel:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 addr = (cpu->R[15] & ~0x2) + ((cur & 0xFF) << 2);
+        cpu->DataRead32(addr, &cpu->R[(cur >> 8) & 0x7]);
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+t_ldr_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 addr = cpu->R[(cur >> 3) & 0x7] + cpu->R[(cur >> 6) & 0x7];
+        u32 val;
+        cpu->DataRead32(addr, &val);
+        cpu->R[cur & 0x7] = ROR(val, 8*(addr&0x3));
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+t_ldrb_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 addr = cpu->R[(cur >> 3) & 0x7] + cpu->R[(cur >> 6) & 0x7];
+        cpu->DataRead8(addr, &cpu->R[cur & 0x7]);
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+t_ldrh_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 addr = cpu->R[(cur >> 3) & 0x7] + cpu->R[(cur >> 6) & 0x7];
+        cpu->DataRead16(addr, &cpu->R[cur & 0x7]);
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+t_ldr_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur >> 4) & 0x7C) + cpu->R[(cur >> 3) & 0x7];
+        u32 val;
+        cpu->DataRead32(offset, &val);
+        cpu->R[cur & 0x7] = ROR(val, 8*(offset&0x3));
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+t_ldrb_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur >> 6) & 0x1F) + cpu->R[(cur >> 3) & 0x7];
+        cpu->DataRead8(offset, &cpu->R[cur & 0x7]);
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+t_ldrh_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur >> 5) & 0x3E) + cpu->R[(cur >> 3) & 0x7];
+        cpu->DataRead16(offset, &cpu->R[cur & 0x7]);
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+t_ldr_sprel:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur << 2) & 0x3FC) + cpu->R[13];
+        cpu->DataRead32(offset, &cpu->R[(cur >> 8) & 0x7]);
+        cpu->AddCycles_CDI();
+        THUMB_NEXT_MEM()
+    }
+
+    // THUMB stores
+
+t_str_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 addr = cpu->R[(cur >> 3) & 0x7] + cpu->R[(cur >> 6) & 0x7];
+        cpu->DataWrite32(addr, cpu->R[cur & 0x7]);
+        cpu->AddCycles_CD();
+        THUMB_NEXT_CHECKED()
+    }
+
+t_strb_reg:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 addr = cpu->R[(cur >> 3) & 0x7] + cpu->R[(cur >> 6) & 0x7];
+        cpu->DataWrite8(addr, cpu->R[cur & 0x7]);
+        cpu->AddCycles_CD();
+        THUMB_NEXT_CHECKED()
+    }
+
+t_str_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur >> 4) & 0x7C) + cpu->R[(cur >> 3) & 0x7];
+        cpu->DataWrite32(offset, cpu->R[cur & 0x7]);
+        cpu->AddCycles_CD();
+        THUMB_NEXT_CHECKED()
+    }
+
+t_strb_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur >> 6) & 0x1F) + cpu->R[(cur >> 3) & 0x7];
+        cpu->DataWrite8(offset, cpu->R[cur & 0x7]);
+        cpu->AddCycles_CD();
+        THUMB_NEXT_CHECKED()
+    }
+
+t_strh_imm:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur >> 5) & 0x3E) + cpu->R[(cur >> 3) & 0x7];
+        cpu->DataWrite16(offset, cpu->R[cur & 0x7]);
+        cpu->AddCycles_CD();
+        THUMB_NEXT_CHECKED()
+    }
+
+t_str_sprel:
+    {
+        u32 cur = cpu->CurInstr;
+        u32 offset = ((cur << 2) & 0x3FC) + cpu->R[13];
+        cpu->DataWrite32(offset, cpu->R[(cur >> 8) & 0x7]);
+        cpu->AddCycles_CD();
+        THUMB_NEXT_CHECKED()
+    }
+
+    // THUMB branches
+
+t_bcond:
+    {
+        u32 instrAddr = cpu->R[15] - 4;
+        if (cpu->CheckCondition((cpu->CurInstr >> 8) & 0xF))
+        {
+            s32 offset = (s32)(cpu->CurInstr << 24) >> 23;
+            cpu->JumpTo(cpu->R[15] + offset + 1);
+            cpu->CheckIdleLoop(true, instrAddr);
+            THUMB_NEXT_CHECKED()
+        }
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+t_b:
+    {
+        u32 instrAddr = cpu->R[15] - 4;
+        s32 offset = (s32)((cpu->CurInstr & 0x7FF) << 21) >> 20;
+        cpu->JumpTo(cpu->R[15] + offset + 1);
+        cpu->CheckIdleLoop(true, instrAddr);
+        THUMB_NEXT_CHECKED()
+    }
+
+t_bl_long_1:
+    {
+        s32 offset = (s32)((cpu->CurInstr & 0x7FF) << 21) >> 9;
+        cpu->R[14] = cpu->R[15] + offset;
+        cpu->AddCycles_C();
+        THUMB_NEXT()
+    }
+
+t_bl_long_2:
+    {
+        u32 instrAddr = cpu->R[15] - 4;
+        s32 offset = (cpu->CurInstr & 0x7FF) << 1;
+        u32 pc = cpu->R[14] + offset;
+        cpu->R[14] = (cpu->R[15] - 2) | 1;
+
+        if ((cpu->Num==1) || (cpu->CurInstr & (1<<12)))
+            pc |= 1;
+
+        cpu->JumpTo(pc);
+        cpu->CheckIdleLoop(true, instrAddr);
+        if (cpu->StopExecution) goto check;
+        goto next;
+    }
+}
+
+void ExecuteThreaded(ARMv5* cpu)
+{
+    ExecuteThreaded<ARMv5>(cpu);
+}
+
+void ExecuteThreaded(ARMv4* cpu)
+{
+    ExecuteThreaded<ARMv4>(cpu);
+}
+
+}
+
+#endif
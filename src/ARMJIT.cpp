@@ -20,7 +20,9 @@
 
 #include <string.h>
 #include <assert.h>
-#include <unordered_map>
+#include <atomic>
+#include <vector>
+#include <new>
 
 #define XXH_STATIC_LINKING_ONLY
 #include "xxhash/xxhash.h"
@@ -30,6 +32,7 @@
 #include "ARMJIT_Internal.h"
 #include "ARMJIT_Memory.h"
 #include "ARMJIT_Compiler.h"
+#include "ARMJIT_PerfDump.h"
 
 #include "ARMInterpreter_ALU.h"
 #include "ARMInterpreter_LoadStore.h"
@@ -61,12 +64,64 @@ int MaxBlockSize;
 bool LiteralOptimizations;
 bool BranchOptimizations;
 bool FastMemory;
+bool AsyncCompilation;
+bool TieredCompilation;
+
+Statistics Stats;
+
+// with tiered compilation blocks which were cut off at MaxBlockSize are
+// profiled. Once one of them was entered often enough it's recompiled with
+// a higher size limit, so that the trace follows more branches and keeps
+// the guest registers and flags in host registers for longer.
+const u32 HotBlockThreshold = 0x400;
+const int MaxTraceSize = 128;
+
+
+BlockMap<JitBlock> JitBlocks9;
+BlockMap<JitBlock> JitBlocks7;
+
+BlockMap<JitBlock> RestoreCandidates;
+
+// blocks are carved out of big chunks, which are kept until DeInit
+// freed blocks go into a free list per size class (in 16 byte steps)
+const u32 BlockPoolChunkSize = 0x40000;
+std::vector<u8*> BlockPoolChunks;
+u32 BlockPoolChunk;
+u32 BlockPoolOffset;
+std::vector<void*> BlockPoolFreeLists;
+
+// with background compilation the emulation thread still fetches (and thereby
+// interprets) a missing block, but only queues it. The code is emitted by the
+// compile thread and the block is published the next time the emulation
+// thread polls. Until then the block is only registered with the code ranges,
+// so that writes to its code still invalidate it.
+struct CompileJob
+{
+    ARM* Cpu;
+    JitBlock* Block; // NULL if the block was dropped in the meantime
+    JitBlock* ProfiledBlock;
+    bool Thumb;
+    bool HasMemoryInstr;
+    int NumInstrs;
+    JitBlockEntry Result;
+    u32 CodeSize;
+    ARMJIT_Memory::MapState MapState;
+    FetchedInstr Instrs[MaxTraceSize];
+};
 
+const u32 CompileQueueSize = 64;
+CompileJob CompileQueue[CompileQueueSize];
+// all of them only count up, published <= compiled <= queued
+std::atomic<u32> JobsQueued;
+std::atomic<u32> JobsCompiled;
+u32 JobsPublished;
+std::atomic_bool CodeSegmentFull;
 
-std::unordered_map<u32, JitBlock*> JitBlocks9;
-std::unordered_map<u32, JitBlock*> JitBlocks7;
-
-std::unordered_map<u32, JitBlock*> RestoreCandidates;
+Platform::Thread* CompileThread;
+std::atomic_bool CompileThreadRunning;
+Platform::Semaphore* Sema_CompileStart;
+// held by whoever uses the compiler, including patching fastmem accesses
+Platform::Mutex* CompilerLock;
 
 TinyVector<u32> InvalidLiterals;
 
@@ -178,6 +233,8 @@ u32 LocaliseCodeAddress(u32 num, u32 addr)
 template <typename T, int ConsoleType>
 T SlowRead9(u32 addr, ARMv5* cpu)
 {
+    Stats.SlowReads++;
+
     u32 offset = addr & 0x3;
     addr &= ~(sizeof(T) - 1);
 
@@ -202,6 +259,8 @@ T SlowRead9(u32 addr, ARMv5* cpu)
 template <typename T, int ConsoleType>
 void SlowWrite9(u32 addr, ARMv5* cpu, u32 val)
 {
+    Stats.SlowWrites++;
+
     addr &= ~(sizeof(T) - 1);
 
     if (addr < cpu->ITCMSize)
@@ -230,6 +289,8 @@ void SlowWrite9(u32 addr, ARMv5* cpu, u32 val)
 template <typename T, int ConsoleType>
 T SlowRead7(u32 addr)
 {
+    Stats.SlowReads++;
+
     u32 offset = addr & 0x3;
     addr &= ~(sizeof(T) - 1);
 
@@ -250,6 +311,8 @@ T SlowRead7(u32 addr)
 template <typename T, int ConsoleType>
 void SlowWrite7(u32 addr, u32 val)
 {
+    Stats.SlowWrites++;
+
     addr &= ~(sizeof(T) - 1);
 
     if (std::is_same<T, u32>::value)
@@ -263,6 +326,8 @@ void SlowWrite7(u32 addr, u32 val)
 template <bool Write, int ConsoleType>
 void SlowBlockTransfer9(u32 addr, u64* data, u32 num, ARMv5* cpu)
 {
+    Stats.SlowBlockTransfers++;
+
     addr &= ~0x3;
     for (u32 i = 0; i < num; i++)
     {
@@ -277,6 +342,8 @@ void SlowBlockTransfer9(u32 addr, u64* data, u32 num, ARMv5* cpu)
 template <bool Write, int ConsoleType>
 void SlowBlockTransfer7(u32 addr, u64* data, u32 num)
 {
+    Stats.SlowBlockTransfers++;
+
     addr &= ~0x3;
     for (u32 i = 0; i < num; i++)
     {
@@ -313,19 +380,183 @@ void SlowBlockTransfer7(u32 addr, u64* data, u32 num)
 INSTANTIATE_SLOWMEM(0)
 INSTANTIATE_SLOWMEM(1)
 
+void LockCompiler()
+{
+    if (CompileThread)
+        Platform::Mutex_Lock(CompilerLock);
+}
+
+void UnlockCompiler()
+{
+    if (CompileThread)
+        Platform::Mutex_Unlock(CompilerLock);
+}
+
+void CompileThreadFunc()
+{
+    // this thread never executes any of the code
+    JitEnableWrite();
+
+    while (CompileThreadRunning)
+    {
+        Platform::Semaphore_Wait(Sema_CompileStart);
+
+        while (CompileThreadRunning)
+        {
+            Platform::Mutex_Lock(CompilerLock);
+
+            u32 cur = JobsCompiled.load(std::memory_order_relaxed);
+            if (cur == JobsQueued.load(std::memory_order_acquire))
+            {
+                Platform::Mutex_Unlock(CompilerLock);
+                break;
+            }
+            if (JITCompiler->IsCodeSegmentFull())
+            {
+                // evicting blocks has to be done by the emulation thread
+                CodeSegmentFull = true;
+                Platform::Mutex_Unlock(CompilerLock);
+                break;
+            }
+
+            CompileJob& job = CompileQueue[cur % CompileQueueSize];
+            job.Result = JITCompiler->CompileBlock(job.Cpu, job.Thumb, job.Instrs, job.NumInstrs, job.HasMemoryInstr, job.ProfiledBlock, job.MapState);
+            job.CodeSize = JITCompiler->LastBlockSize;
+            JobsCompiled.store(cur + 1, std::memory_order_release);
+
+            Platform::Mutex_Unlock(CompilerLock);
+        }
+    }
+}
+
+void StartCompileThread()
+{
+    if (CompileThread)
+        return;
+
+    CompileThreadRunning = true;
+    CompileThread = Platform::Thread_Create(CompileThreadFunc);
+}
+
+void StopCompileThread()
+{
+    if (!CompileThread)
+        return;
+
+    CompileThreadRunning = false;
+    Platform::Semaphore_Post(Sema_CompileStart);
+    Platform::Thread_Wait(CompileThread);
+    Platform::Thread_Free(CompileThread);
+    CompileThread = NULL;
+}
+
+void PublishCompiledBlocks()
+{
+    u32 compiled = JobsCompiled.load(std::memory_order_acquire);
+    if (JobsPublished == compiled)
+        return;
+
+#ifdef __aarch64__
+    // the code was written by another core
+    __asm__ volatile("isb");
+#endif
+
+    for (; JobsPublished != compiled; JobsPublished++)
+    {
+        CompileJob& job = CompileQueue[JobsPublished % CompileQueueSize];
+        JitBlock* block = job.Block;
+        if (!block)
+            continue;
+
+        block->EntryPoint = job.Result;
+        Stats.BlocksCompiled++;
+        Stats.CodeBytes += job.CodeSize;
+
+        u64* entry = &FastBlockLookupRegions[block->StartAddrLocal >> 27][(block->StartAddrLocal & 0x7FFFFFF) / 2];
+        *entry = ((u64)block->StartAddr | block->Num) << 32;
+        *entry |= JITCompiler->SubEntryOffset(block->EntryPoint);
+    }
+}
+
+void CancelCompileJob(JitBlock* block)
+{
+    u32 queued = JobsQueued.load(std::memory_order_relaxed);
+    for (u32 i = JobsPublished; i != queued; i++)
+    {
+        if (CompileQueue[i % CompileQueueSize].Block == block)
+        {
+            CompileQueue[i % CompileQueueSize].Block = NULL;
+            return;
+        }
+    }
+}
+
+// has to be called with the compiler locked and writing to the code memory enabled
+void MakeCodeSpace()
+{
+    if (JITCompiler->IsCodeSegmentFull())
+    {
+        // make sure everything which was compiled is known before evicting
+        PublishCompiledBlocks();
+        JITCompiler->NextCodeSegment();
+    }
+}
+
+void PollCompileThread()
+{
+    if (!CompileThread)
+        return;
+
+    if (CodeSegmentFull.load(std::memory_order_relaxed))
+    {
+        JitEnableWrite();
+        Platform::Mutex_Lock(CompilerLock);
+        MakeCodeSpace();
+        CodeSegmentFull = false;
+        Platform::Mutex_Unlock(CompilerLock);
+        JitEnableExecute();
+
+        Platform::Semaphore_Post(Sema_CompileStart);
+    }
+
+    PublishCompiledBlocks();
+}
+
 void Init()
 {
     JITCompiler = new Compiler();
 
+    CompileThread = NULL;
+    CompileThreadRunning = false;
+    Sema_CompileStart = Platform::Semaphore_Create();
+    CompilerLock = Platform::Mutex_Create();
+
     ARMJIT_Memory::Init();
+
+#ifdef JIT_PERF_DUMP_ENABLED
+    ARMJIT_PerfDump::Init();
+#endif
 }
 
 void DeInit()
 {
+    StopCompileThread();
+
     JitEnableWrite();
     ResetBlockCache();
     ARMJIT_Memory::DeInit();
 
+#ifdef JIT_PERF_DUMP_ENABLED
+    ARMJIT_PerfDump::DeInit();
+#endif
+
+    Platform::Semaphore_Free(Sema_CompileStart);
+    Platform::Mutex_Free(CompilerLock);
+
+    for (u8* chunk : BlockPoolChunks)
+        delete[] chunk;
+    BlockPoolChunks.clear();
+
     delete JITCompiler;
 }
 
@@ -335,6 +566,8 @@ void Reset()
     LiteralOptimizations = Platform::GetConfigBool(Platform::JIT_LiteralOptimizations);
     BranchOptimizations = Platform::GetConfigBool(Platform::JIT_BranchOptimizations);
     FastMemory = Platform::GetConfigBool(Platform::JIT_FastMemory);
+    AsyncCompilation = Platform::GetConfigBool(Platform::JIT_AsyncCompilation);
+    TieredCompilation = Platform::GetConfigBool(Platform::JIT_TieredCompilation);
 
     if (MaxBlockSize < 1)
         MaxBlockSize = 1;
@@ -345,6 +578,23 @@ void Reset()
     ResetBlockCache();
 
     ARMJIT_Memory::Reset();
+
+    if (AsyncCompilation)
+        StartCompileThread();
+    else
+        StopCompileThread();
+
+    ResetStats();
+}
+
+const Statistics& GetStats()
+{
+    return Stats;
+}
+
+void ResetStats()
+{
+    memset(&Stats, 0, sizeof(Stats));
 }
 
 void FloodFillSetFlags(FetchedInstr instrs[], int start, u8 flags)
@@ -392,6 +642,313 @@ bool DecodeLiteral(bool thumb, const FetchedInstr& instr, u32& addr)
     return false;
 }
 
+// extracts the value a literal load loads from the word containing it
+u32 FoldLiteral(bool thumb, const FetchedInstr& instr, u32 addr, u32 word)
+{
+    if (!thumb && instr.Info.Kind == ARMInstrInfo::ak_LDRB_IMM)
+        return (u8)(word >> ((addr & 0x3) << 3));
+    if (!thumb && instr.Info.Kind == ARMInstrInfo::ak_LDRH_IMM)
+        return (u16)(word >> ((addr & 0x2) << 3));
+    return ROR(word, (addr & 0x3) << 3);
+}
+
+bool A_EvalConstant(const FetchedInstr& instr, u16 known, const u32* values, int& dst, u32& result)
+{
+    if (instr.Cond() != 0xE)
+        return false;
+
+    auto getReg = [&](int reg, u32& val)
+    {
+        if (reg == 15)
+            val = instr.Addr + 8;
+        else if (known & (1 << reg))
+            val = values[reg];
+        else
+            return false;
+        return true;
+    };
+
+    dst = instr.A_Reg(12);
+    if (dst == 15)
+        return false;
+
+    u32 kind = instr.Info.Kind;
+    if (kind <= ARMInstrInfo::ak_MVN_IMM_S)
+    {
+        u32 op2;
+        if (instr.Instr & (1 << 25))
+            op2 = ROR(instr.Instr & 0xFF, (instr.Instr >> 7) & 0x1E);
+        else if ((instr.Instr & 0x70) == 0 && getReg(instr.A_Reg(0), op2))
+            op2 <<= (instr.Instr >> 7) & 0x1F;
+        else
+            return false;
+
+        u32 op = (instr.Instr >> 21) & 0xF;
+        if (op == 0xD)
+        {
+            result = op2;
+            return true;
+        }
+        if (op == 0xF)
+        {
+            result = ~op2;
+            return true;
+        }
+
+        u32 rn;
+        if (!getReg(instr.A_Reg(16), rn))
+            return false;
+        switch (op)
+        {
+        case 0x0: result = rn & op2; return true;
+        case 0x1: result = rn ^ op2; return true;
+        case 0x2: result = rn - op2; return true;
+        case 0x3: result = op2 - rn; return true;
+        case 0x4: result = rn + op2; return true;
+        case 0xC: result = rn | op2; return true;
+        case 0xE: result = rn & ~op2; return true;
+        }
+        // the rest depends on the carry or doesn't write a register
+        return false;
+    }
+
+    if ((kind == ARMInstrInfo::ak_LDR_IMM || kind == ARMInstrInfo::ak_LDRB_IMM || kind == ARMInstrInfo::ak_LDRH_IMM)
+        && instr.HasLiteral && !(instr.Instr & (1 << 21)))
+    {
+        result = instr.LiteralValue;
+        return true;
+    }
+
+    return false;
+}
+
+bool T_EvalConstant(const FetchedInstr& instr, u16 known, const u32* values, int& dst, u32& result)
+{
+    auto getReg = [&](int reg, u32& val)
+    {
+        if (reg == 15)
+            val = instr.Addr + 4;
+        else if (known & (1 << reg))
+            val = values[reg];
+        else
+            return false;
+        return true;
+    };
+
+    u32 rs, rn;
+    u32 imm5 = (instr.Instr >> 6) & 0x1F;
+    switch (instr.Info.Kind)
+    {
+    case ARMInstrInfo::tk_LSL_IMM:
+    case ARMInstrInfo::tk_LSR_IMM:
+    case ARMInstrInfo::tk_ASR_IMM:
+        dst = instr.T_Reg(0);
+        if (!getReg(instr.T_Reg(3), rs))
+            return false;
+        if (instr.Info.Kind == ARMInstrInfo::tk_LSL_IMM)
+            result = rs << imm5;
+        else if (instr.Info.Kind == ARMInstrInfo::tk_LSR_IMM)
+            result = imm5 ? rs >> imm5 : 0;
+        else
+            result = (s32)rs >> (imm5 ? imm5 : 31);
+        return true;
+    case ARMInstrInfo::tk_ADD_REG_:
+    case ARMInstrInfo::tk_SUB_REG_:
+    case ARMInstrInfo::tk_ADD_IMM_:
+    case ARMInstrInfo::tk_SUB_IMM_:
+        {
+            dst = instr.T_Reg(0);
+            u32 op2 = instr.T_Reg(6);
+            if (!getReg(instr.T_Reg(3), rn)
+                || (instr.Info.Kind <= ARMInstrInfo::tk_SUB_REG_ && !getReg(op2, op2)))
+                return false;
+            bool sub = instr.Info.Kind == ARMInstrInfo::tk_SUB_REG_ || instr.Info.Kind == ARMInstrInfo::tk_SUB_IMM_;
+            result = sub ? rn - op2 : rn + op2;
+        }
+        return true;
+    case ARMInstrInfo::tk_MOV_IMM:
+        dst = instr.T_Reg(8);
+        result = instr.Instr & 0xFF;
+        return true;
+    case ARMInstrInfo::tk_ADD_IMM:
+    case ARMInstrInfo::tk_SUB_IMM:
+        dst = instr.T_Reg(8);
+        if (!getReg(dst, rn))
+            return false;
+        result = instr.Info.Kind == ARMInstrInfo::tk_ADD_IMM ? rn + (instr.Instr & 0xFF) : rn - (instr.Instr & 0xFF);
+        return true;
+    case ARMInstrInfo::tk_AND_REG:
+    case ARMInstrInfo::tk_EOR_REG:
+    case ARMInstrInfo::tk_LSL_REG:
+    case ARMInstrInfo::tk_LSR_REG:
+    case ARMInstrInfo::tk_NEG_REG:
+    case ARMInstrInfo::tk_ORR_REG:
+    case ARMInstrInfo::tk_MUL_REG:
+    case ARMInstrInfo::tk_BIC_REG:
+    case ARMInstrInfo::tk_MVN_REG:
+        dst = instr.T_Reg(0);
+        if (!getReg(instr.T_Reg(3), rs))
+            return false;
+        if (instr.Info.Kind == ARMInstrInfo::tk_NEG_REG || instr.Info.Kind == ARMInstrInfo::tk_MVN_REG)
+        {
+            result = instr.Info.Kind == ARMInstrInfo::tk_NEG_REG ? -rs : ~rs;
+            return true;
+        }
+        if (!getReg(dst, rn))
+            return false;
+        switch (instr.Info.Kind)
+        {
+        case ARMInstrInfo::tk_AND_REG: result = rn & rs; break;
+        case ARMInstrInfo::tk_EOR_REG: result = rn ^ rs; break;
+        case ARMInstrInfo::tk_LSL_REG: result = (rs & 0xFF) < 32 ? rn << (rs & 0xFF) : 0; break;
+        case ARMInstrInfo::tk_LSR_REG: result = (rs & 0xFF) < 32 ? rn >> (rs & 0xFF) : 0; break;
+        case ARMInstrInfo::tk_ORR_REG: result = rn | rs; break;
+        case ARMInstrInfo::tk_MUL_REG: result = rn * rs; break;
+        case ARMInstrInfo::tk_BIC_REG: result = rn & ~rs; break;
+        }
+        return true;
+    case ARMInstrInfo::tk_MOV_HIREG:
+        dst = (instr.Instr & 0x7) | ((instr.Instr >> 4) & 0x8);
+        return dst != 15 && getReg((instr.Instr >> 3) & 0xF, result);
+    case ARMInstrInfo::tk_ADD_PCREL:
+        dst = instr.T_Reg(8);
+        result = ((instr.Addr + 4) & ~0x2) + ((instr.Instr & 0xFF) << 2);
+        return true;
+    case ARMInstrInfo::tk_LDR_PCREL:
+        dst = instr.T_Reg(8);
+        result = instr.LiteralValue;
+        return instr.HasLiteral;
+    default:
+        return false;
+    }
+}
+
+// a simple constant propagation over the block, which is shared by both compilers
+// values aren't known at the start of the block, only those computed inside of it
+// loads are never replaced by the value of an earlier store to the same address:
+// the address is only known at runtime and might be an IO register,
+// where reading back doesn't give what was written
+void PropagateConstants(bool thumb, FetchedInstr instrs[], int instrsCount)
+{
+    u16 known = 0;
+    u32 values[16];
+
+    for (int i = 0; i < instrsCount; i++)
+    {
+        FetchedInstr& instr = instrs[i];
+        instr.KnownRegs = known;
+
+        int dst;
+        u32 result;
+        bool constant = LiteralOptimizations && (thumb
+            ? T_EvalConstant(instr, known, values, dst, result)
+            : A_EvalConstant(instr, known, values, dst, result));
+
+        known &= ~instr.Info.DstRegs;
+        // switching the mode might bank out some of the registers
+        if (!thumb && (instr.Info.Kind == ARMInstrInfo::ak_MSR_IMM || instr.Info.Kind == ARMInstrInfo::ak_MSR_REG))
+            known = 0;
+
+        if (constant && instr.Info.DstRegs == (1 << dst))
+        {
+            known |= 1 << dst;
+            values[dst] = result;
+            instr.ConstResult = result;
+        }
+    }
+}
+
+void FetchStaticJumpTiming(ARM* cpu, bool thumb, FetchedInstr& instr)
+{
+    // has to match the targets the compilers pass to Comp_JumpTo
+    u32 target;
+    if (thumb)
+    {
+        u32 r15 = instr.Addr + 4;
+        switch (instr.Info.Kind)
+        {
+        case ARMInstrInfo::tk_BCOND:
+            target = r15 + ((s32)(instr.Instr << 24) >> 23) + 1;
+            break;
+        case ARMInstrInfo::tk_B:
+            target = r15 + ((s32)((instr.Instr & 0x7FF) << 21) >> 20) + 1;
+            break;
+        case ARMInstrInfo::tk_BL_LONG:
+            target = r15 + ((s32)((instr.Instr & 0x7FF) << 21) >> 9);
+            target += ((instr.Instr >> 16) & 0x7FF) << 1;
+            if (cpu->Num == 1 || instr.Instr & (1 << 28))
+                target |= 1;
+            break;
+        default:
+            return;
+        }
+    }
+    else
+    {
+        if (instr.Info.Kind != ARMInstrInfo::ak_B
+            && instr.Info.Kind != ARMInstrInfo::ak_BL
+            && instr.Info.Kind != ARMInstrInfo::ak_BLX_IMM)
+            return;
+
+        target = (instr.Addr + 8) + ((s32)(instr.Instr << 8) >> 6);
+        if (instr.Cond() == 0xF)
+            target += (((instr.Instr >> 24) & 1) << 1) + 1;
+    }
+
+    u32 cycles = 0;
+    if (cpu->Num == 0)
+    {
+        ARMv5* cpu9 = (ARMv5*)cpu;
+
+        u32 regionCodeCycles = cpu9->MemTimings(target)[0];
+        u32 curRegionCodeCycles = cpu9->RegionCodeCycles;
+        u32 curCodeCycles = cpu9->CodeCycles;
+        cpu9->RegionCodeCycles = regionCodeCycles;
+
+        if (target & 0x1)
+        {
+            u32 addr = target & ~0x1;
+            // two-opcodes-at-once fetch
+            if (addr & 0x2)
+            {
+                cpu9->CodeRead32(addr-2, true);
+                cycles += cpu9->CodeCycles;
+                cpu9->CodeRead32(addr+2, false);
+                cycles += cpu9->CodeCycles;
+            }
+            else
+            {
+                cpu9->CodeRead32(addr, true);
+                cycles += cpu9->CodeCycles;
+            }
+        }
+        else
+        {
+            u32 addr = target & ~0x3;
+            cpu9->CodeRead32(addr, true);
+            cycles += cpu9->CodeCycles;
+            cpu9->CodeRead32(addr+4, false);
+            cycles += cpu9->CodeCycles;
+        }
+
+        cpu9->RegionCodeCycles = curRegionCodeCycles;
+        cpu9->CodeCycles = curCodeCycles;
+
+        instr.JumpRegionCodeCycles = regionCodeCycles;
+    }
+    else
+    {
+        u32 codeCycles = target >> 15; // cheato
+
+        if (target & 0x1)
+            cycles = NDS::ARM7MemTimings(codeCycles)[0] + NDS::ARM7MemTimings(codeCycles)[1];
+        else
+            cycles = NDS::ARM7MemTimings(codeCycles)[2] + NDS::ARM7MemTimings(codeCycles)[3];
+    }
+
+    instr.JumpCycles = cycles;
+}
+
 bool DecodeBranch(bool thumb, const FetchedInstr& instr, u32& cond, bool hasLink, u32 lr, bool& link,
     u32& linkAddr, u32& targetAddr)
 {
@@ -455,33 +1012,17 @@ bool DecodeBranch(bool thumb, const FetchedInstr& instr, u32& cond, bool hasLink
 
 bool IsIdleLoop(bool thumb, FetchedInstr* instrs, int instrsCount)
 {
-    // see https://github.com/dolphin-emu/dolphin/blob/master/Source/Core/Core/PowerPC/PPCAnalyst.cpp#L678
-    // it basically checks if one iteration of a loop depends on another
-    // the rules are quite simple
-
     JIT_DEBUGPRINT("checking potential idle loop\n");
-    u16 regsWrittenTo = 0;
-    u16 regsDisallowedToWrite = 0;
+
+    u32 loopInstrs[MaxTraceSize];
+    ARMInstrInfo::Info loopInfos[MaxTraceSize];
     for (int i = 0; i < instrsCount; i++)
     {
-        JIT_DEBUGPRINT("instr %d %08x regs(%x %x) %x %x\n", i, instrs[i].Instr, instrs[i].Info.DstRegs, instrs[i].Info.SrcRegs, regsWrittenTo, regsDisallowedToWrite);
-        if (instrs[i].Info.SpecialKind == ARMInstrInfo::special_WriteMem)
-            return false;
-        if (!thumb && instrs[i].Info.Kind >= ARMInstrInfo::ak_MSR_IMM && instrs[i].Info.Kind <= ARMInstrInfo::ak_MRC)
-            return false;
-        if (i < instrsCount - 1 && instrs[i].Info.Branches())
-            return false;
-
-        u16 srcRegs = instrs[i].Info.SrcRegs & ~(1 << 15);
-        u16 dstRegs = instrs[i].Info.DstRegs & ~(1 << 15);
-
-        regsDisallowedToWrite |= srcRegs & ~regsWrittenTo;
-
-        if (dstRegs & regsDisallowedToWrite)
-            return false;
-        regsWrittenTo |= dstRegs;
+        loopInstrs[i] = instrs[i].Instr;
+        loopInfos[i] = instrs[i].Info;
     }
-    return true;
+
+    return ARMInstrInfo::IsIdleLoop(thumb, instrs[0].Addr, loopInstrs, loopInfos, instrsCount);
 }
 
 typedef void (*InterpreterFunc)(ARM* cpu);
@@ -571,18 +1112,87 @@ InterpreterFunc InterpretTHUMB[ARMInstrInfo::tk_Count] =
 };
 #undef F
 
-void RetireJitBlock(JitBlock* block)
+void MaterializeFlags(ARM* cpu)
+{
+    cpu->MaterializeFlags();
+}
+
+u32 JitBlockSizeClass(u32 numAddresses, u32 numLiterals)
+{
+    return (sizeof(JitBlock) + (numAddresses * 2 + numLiterals) * sizeof(u32) + 15) / 16;
+}
+
+JitBlock* AllocJitBlock(u32 num, u32 numAddresses, u32 numLiterals)
 {
-    auto it = RestoreCandidates.find(block->InstrHash);
-    if (it != RestoreCandidates.end())
+    u32 sizeClass = JitBlockSizeClass(numAddresses, numLiterals);
+    if (sizeClass >= BlockPoolFreeLists.size())
+        BlockPoolFreeLists.resize(sizeClass + 1, NULL);
+
+    void* mem = BlockPoolFreeLists[sizeClass];
+    if (mem)
     {
-        delete it->second;
-        it->second = block;
+        BlockPoolFreeLists[sizeClass] = *(void**)mem;
     }
     else
     {
-        RestoreCandidates[block->InstrHash] = block;
+        u32 size = sizeClass * 16;
+        assert(size <= BlockPoolChunkSize);
+        if (BlockPoolChunk == BlockPoolChunks.size() || BlockPoolOffset + size > BlockPoolChunkSize)
+        {
+            if (BlockPoolChunk < BlockPoolChunks.size())
+                BlockPoolChunk++;
+            if (BlockPoolChunk == BlockPoolChunks.size())
+                BlockPoolChunks.push_back(new u8[BlockPoolChunkSize]);
+            BlockPoolOffset = 0;
+        }
+
+        mem = BlockPoolChunks[BlockPoolChunk] + BlockPoolOffset;
+        BlockPoolOffset += size;
     }
+
+    return new (mem) JitBlock(num, numAddresses, numLiterals);
+}
+
+void FreeJitBlock(JitBlock* block)
+{
+    if (!block->EntryPoint)
+        CancelCompileJob(block);
+
+    u32 sizeClass = JitBlockSizeClass(block->NumAddresses, block->NumLiterals);
+    *(void**)block = BlockPoolFreeLists[sizeClass];
+    BlockPoolFreeLists[sizeClass] = block;
+}
+
+void ResetJitBlockPool()
+{
+    // only valid once every block has been dropped
+    BlockPoolFreeLists.clear();
+    BlockPoolChunk = 0;
+    BlockPoolOffset = 0;
+}
+
+void RetireJitBlock(JitBlock* block)
+{
+    // there's nothing to restore if the block was never compiled
+    if (!block->EntryPoint)
+    {
+        FreeJitBlock(block);
+        return;
+    }
+
+    JitBlock* prev = RestoreCandidates.Insert(block->InstrHash, block);
+    if (prev)
+        FreeJitBlock(prev);
+}
+
+void UnlinkJitBlock(JitBlock* block);
+
+void MarkBlockHot(JitBlock* block)
+{
+    // make the next lookup miss, so that the block gets recompiled
+    u64* entry = &FastBlockLookupRegions[block->StartAddrLocal >> 27][(block->StartAddrLocal & 0x7FFFFFF) / 2];
+    if ((u32)*entry == JITCompiler->SubEntryOffset(block->EntryPoint))
+        *entry = (u64)UINT32_MAX << 32;
 }
 
 void CompileBlock(ARM* cpu)
@@ -597,48 +1207,80 @@ void CompileBlock(ARM* cpu)
         printf("trying to compile non executable code? %x\n", blockAddr);
     }
 
+    PollCompileThread();
+
+    // the block is already queued for compilation, it only
+    // needs to be interpreted until then
+    bool compiling = false;
+    int tier = 1;
+
     auto& map = cpu->Num == 0 ? JitBlocks9 : JitBlocks7;
-    auto existingBlockIt = map.find(blockAddr);
-    if (existingBlockIt != map.end())
+    JitBlock* existingBlock = map.Find(blockAddr);
+    if (existingBlock)
     {
         // there's already a block, though it's not inside the fast map
         // could be that there are two blocks at the same physical addr
         // but different mirrors
-        u32 otherLocalAddr = existingBlockIt->second->StartAddrLocal;
+        u32 otherLocalAddr = existingBlock->StartAddrLocal;
 
-        if (localAddr == otherLocalAddr)
+        if (localAddr == otherLocalAddr && !existingBlock->EntryPoint)
         {
-            JIT_DEBUGPRINT("switching out block %x %x %x\n", localAddr, blockAddr, existingBlockIt->second->StartAddr);
+            compiling = true;
+        }
+        else if (localAddr == otherLocalAddr && TieredCompilation && existingBlock->Profiled && existingBlock->ExecCounter == 0)
+        {
+            JIT_DEBUGPRINT("recompiling hot block %x\n", blockAddr);
+
+            // the trace starts with the same instructions, so there's no point in keeping it around
+            UnlinkJitBlock(existingBlock);
+            FreeJitBlock(existingBlock);
+            tier = 2;
+            Stats.Traces++;
+        }
+        else if (localAddr == otherLocalAddr)
+        {
+            JIT_DEBUGPRINT("switching out block %x %x %x\n", localAddr, blockAddr, existingBlock->StartAddr);
 
             u64* entry = &FastBlockLookupRegions[localAddr >> 27][(localAddr & 0x7FFFFFF) / 2];
             *entry = ((u64)blockAddr | cpu->Num) << 32;
-            *entry |= JITCompiler->SubEntryOffset(existingBlockIt->second->EntryPoint);
+            *entry |= JITCompiler->SubEntryOffset(existingBlock->EntryPoint);
             return;
         }
-
-        // some memory has been remapped
-        RetireJitBlock(existingBlockIt->second);
-        map.erase(existingBlockIt);
+        else if (!existingBlock->EntryPoint)
+        {
+            // some memory has been remapped while the block was still queued
+            UnlinkJitBlock(existingBlock);
+            FreeJitBlock(existingBlock);
+        }
+        else
+        {
+            // some memory has been remapped
+            RetireJitBlock(existingBlock);
+            map.Erase(blockAddr);
+        }
     }
 
-    FetchedInstr instrs[MaxBlockSize];
+    int maxInstrs = tier == 2 ? MaxTraceSize : MaxBlockSize;
+
+    FetchedInstr instrs[maxInstrs];
     int i = 0;
     u32 r15 = cpu->R[15];
 
-    u32 addressRanges[MaxBlockSize];
-    u32 addressMasks[MaxBlockSize];
-    memset(addressMasks, 0, MaxBlockSize * sizeof(u32));
+    u32 addressRanges[maxInstrs];
+    u32 addressMasks[maxInstrs];
+    memset(addressMasks, 0, maxInstrs * sizeof(u32));
     u32 numAddressRanges = 0;
 
     u32 numLiterals = 0;
-    u32 literalLoadAddrs[MaxBlockSize];
+    u32 literalLoadAddrs[maxInstrs];
+    u32 literalInstrs[maxInstrs];
     // they are going to be hashed
-    u32 literalValues[MaxBlockSize];
-    u32 instrValues[MaxBlockSize];
+    u32 literalValues[maxInstrs];
+    u32 instrValues[maxInstrs];
     // due to instruction merging i might not reflect the amount of actual instructions
     u32 numInstrs = 0;
 
-    u32 writeAddrs[MaxBlockSize];
+    u32 writeAddrs[maxInstrs];
     u32 numWriteAddrs = 0, writeAddrsTranslated = 0;
 
     cpu->FillPipeline();
@@ -659,6 +1301,7 @@ void CompileBlock(ARM* cpu)
 
         instrs[i].BranchFlags = 0;
         instrs[i].SetFlags = 0;
+        instrs[i].HasLiteral = false;
         instrs[i].Instr = nextInstr[0];
         nextInstr[0] = nextInstr[1];
 
@@ -712,6 +1355,9 @@ void CompileBlock(ARM* cpu)
             else
                 nextInstr[1] = cpuv4->CodeRead32(r15);
             instrs[i].CodeCycles = cpu->CodeCycles;
+            u8* codeTimings = NDS::ARM7MemTimings(cpu->CodeCycles);
+            instrs[i].NonseqCodeCycles = codeTimings[thumb ? 0 : 2];
+            instrs[i].SeqCodeCycles = codeTimings[thumb ? 1 : 3];
         }
         instrs[i].Info = ARMInstrInfo::Decode(thumb, cpu->Num, instrs[i].Instr);
 
@@ -779,6 +1425,9 @@ void CompileBlock(ARM* cpu)
                 addressMasks[j] |= 1 << ((translatedAddr & 0x1FF) / 16);
                 JIT_DEBUGPRINT("literal loading %08x %08x %08x %08x\n", literalAddr, translatedAddr, addressMasks[j], addressRanges[j]);
                 cpu->DataRead32(literalAddr, &literalValues[numLiterals]);
+                instrs[i].HasLiteral = true;
+                instrs[i].LiteralValue = FoldLiteral(thumb, instrs[i], literalAddr, literalValues[numLiterals]);
+                literalInstrs[numLiterals] = i;
                 literalLoadAddrs[numLiterals++] = translatedAddr;
             }
         }
@@ -823,17 +1472,22 @@ void CompileBlock(ARM* cpu)
                     }
                 }
 
-                if (cond < 0xE && target < instrs[i].Addr && target >= lastSegmentStart)
+                bool isLoop = target <= instrs[i].Addr && target >= lastSegmentStart;
+                bool isIdleLoop = false;
+                if (isLoop)
                 {
                     // we might have an idle loop
                     u32 backwardsOffset = (instrs[i].Addr - target) / (thumb ? 2 : 4);
                     if (IsIdleLoop(thumb, &instrs[i - backwardsOffset], backwardsOffset + 1))
                     {
+                        isIdleLoop = true;
                         instrs[i].BranchFlags |= branch_IdleBranch;
                         JIT_DEBUGPRINT("found %s idle loop %d in block %08x\n", thumb ? "thumb" : "arm", cpu->Num, blockAddr);
                     }
                 }
-                else if (hasBranched && !isBackJump && i + 1 < MaxBlockSize)
+
+                // unconditional loops are unrolled into the block, unless they're idle
+                if ((!isLoop || (cond == 0xE && !isIdleLoop)) && hasBranched && !isBackJump && i + 1 < maxInstrs)
                 {
                     if (link)
                     {
@@ -861,7 +1515,7 @@ void CompileBlock(ARM* cpu)
                 }
             }
 
-            if (!hasBranched && cond < 0xE && i + 1 < MaxBlockSize)
+            if (!hasBranched && cond < 0xE && i + 1 < maxInstrs)
             {
                 JIT_DEBUGPRINT("block lengthened by untaken branch\n");
                 instrs[i].Info.EndBlock = false;
@@ -871,11 +1525,13 @@ void CompileBlock(ARM* cpu)
 
         i++;
 
+        FetchStaticJumpTiming(cpu, thumb, instrs[i - 1]);
+
         bool canCompile = JITCompiler->CanCompile(thumb, instrs[i - 1].Info.Kind);
         bool secondaryFlagReadCond = !canCompile || (instrs[i - 1].BranchFlags & (branch_FollowCondTaken | branch_FollowCondNotTaken));
         if (instrs[i - 1].Info.ReadFlags != 0 || secondaryFlagReadCond)
             FloodFillSetFlags(instrs, i - 2, !secondaryFlagReadCond ? instrs[i - 1].Info.ReadFlags : 0xF);
-    } while(!instrs[i - 1].Info.EndBlock && i < MaxBlockSize && !cpu->Halted && (!cpu->IRQ || (cpu->CPSR & 0x80)));
+    } while(!instrs[i - 1].Info.EndBlock && i < maxInstrs && !cpu->Halted && (!cpu->IRQ || (cpu->CPSR & 0x80)));
 
     if (numLiterals)
     {
@@ -895,19 +1551,24 @@ void CompileBlock(ARM* cpu)
                 }
             }
         }
+
+        for (u32 j = 0; j < numLiterals; j++)
+        {
+            if (InvalidLiterals.Find(literalLoadAddrs[j]) != -1)
+                instrs[literalInstrs[j]].HasLiteral = false;
+        }
     }
 
+    if (compiling)
+        return;
+
     u32 literalHash = (u32)XXH3_64bits(literalValues, numLiterals * 4);
     u32 instrHash = (u32)XXH3_64bits(instrValues, numInstrs * 4);
 
-    auto prevBlockIt = RestoreCandidates.find(instrHash);
-    JitBlock* prevBlock = NULL;
+    JitBlock* prevBlock = RestoreCandidates.Erase(instrHash);
     bool mayRestore = true;
-    if (prevBlockIt != RestoreCandidates.end())
+    if (prevBlock)
     {
-        prevBlock = prevBlockIt->second;
-        RestoreCandidates.erase(prevBlockIt);
-
         mayRestore = prevBlock->StartAddr == blockAddr && prevBlock->LiteralHash == literalHash;
 
         if (mayRestore && prevBlock->NumAddresses == numAddressRanges)
@@ -934,9 +1595,12 @@ void CompileBlock(ARM* cpu)
     if (!mayRestore)
     {
         if (prevBlock)
-            delete prevBlock;
+        {
+            Stats.RestoreMisses++;
+            FreeJitBlock(prevBlock);
+        }
 
-        block = new JitBlock(cpu->Num, i, numAddressRanges, numLiterals);
+        block = AllocJitBlock(cpu->Num, numAddressRanges, numLiterals);
         block->LiteralHash = literalHash;
         block->InstrHash = instrHash;
         for (u32 j = 0; j < numAddressRanges; j++)
@@ -950,17 +1614,61 @@ void CompileBlock(ARM* cpu)
         block->StartAddrLocal = localAddr;
 
         FloodFillSetFlags(instrs, i - 1, 0xF);
+        PropagateConstants(thumb, instrs, i);
 
-        JitEnableWrite();
-        block->EntryPoint = JITCompiler->CompileBlock(cpu, thumb, instrs, i, hasMemoryInstr);
-        JitEnableExecute();
+        // only blocks which were cut off can get any longer
+        JitBlock* profiledBlock = NULL;
+        if (TieredCompilation && tier == 1 && i == maxInstrs && maxInstrs < MaxTraceSize)
+        {
+            block->ExecCounter = HotBlockThreshold;
+            block->Profiled = true;
+            profiledBlock = block;
+        }
 
-        JIT_DEBUGPRINT("block start %p\n", block->EntryPoint);
+        u32 queued = JobsQueued.load(std::memory_order_relaxed);
+        if (CompileThread && queued - JobsPublished < CompileQueueSize)
+        {
+            CompileJob& job = CompileQueue[queued % CompileQueueSize];
+            job.Cpu = cpu;
+            job.Block = block;
+            job.ProfiledBlock = profiledBlock;
+            job.Thumb = thumb;
+            job.HasMemoryInstr = hasMemoryInstr;
+            job.NumInstrs = i;
+            ARMJIT_Memory::GetMapState(job.MapState);
+            memcpy(job.Instrs, instrs, i * sizeof(FetchedInstr));
+            JobsQueued.store(queued + 1, std::memory_order_release);
+
+            Platform::Semaphore_Post(Sema_CompileStart);
+
+            JIT_DEBUGPRINT("block queued %p\n", block);
+        }
+        else
+        {
+            ARMJIT_Memory::MapState mapState;
+            ARMJIT_Memory::GetMapState(mapState);
+
+            JitEnableWrite();
+            LockCompiler();
+            MakeCodeSpace();
+            block->EntryPoint = JITCompiler->CompileBlock(cpu, thumb, instrs, i, hasMemoryInstr, profiledBlock, mapState);
+            Stats.BlocksCompiled++;
+            Stats.CodeBytes += JITCompiler->LastBlockSize;
+            UnlockCompiler();
+            JitEnableExecute();
+
+            JIT_DEBUGPRINT("block start %p\n", block->EntryPoint);
+        }
     }
     else
     {
         JIT_DEBUGPRINT("restored! %p\n", prevBlock);
         block = prevBlock;
+        Stats.BlocksRestored++;
+
+        // it has to become hot again before it's turned into a trace
+        if (block->Profiled)
+            block->ExecCounter = HotBlockThreshold;
     }
 
     assert((localAddr & 1) == 0);
@@ -981,13 +1689,17 @@ void CompileBlock(ARM* cpu)
     }
 
     if (cpu->Num == 0)
-        JitBlocks9[blockAddr] = block;
+        JitBlocks9.Insert(blockAddr, block);
     else
-        JitBlocks7[blockAddr] = block;
+        JitBlocks7.Insert(blockAddr, block);
 
-    u64* entry = &FastBlockLookupRegions[(localAddr >> 27)][(localAddr & 0x7FFFFFF) / 2];
-    *entry = ((u64)blockAddr | cpu->Num) << 32;
-    *entry |= JITCompiler->SubEntryOffset(block->EntryPoint);
+    // queued blocks are entered once they're published
+    if (block->EntryPoint)
+    {
+        u64* entry = &FastBlockLookupRegions[(localAddr >> 27)][(localAddr & 0x7FFFFFF) / 2];
+        *entry = ((u64)blockAddr | cpu->Num) << 32;
+        *entry |= JITCompiler->SubEntryOffset(block->EntryPoint);
+    }
 }
 
 void InvalidateByAddr(u32 localAddr)
@@ -1023,6 +1735,7 @@ void InvalidateByAddr(u32 localAddr)
             continue;
         }
         range->Blocks.Remove(i);
+        Stats.BlocksInvalidated[localAddr >> 27]++;
 
         if (range->Blocks.Length == 0
             && !PageContainsCode(&region[(localAddr & 0x7FFF000) / 512]))
@@ -1069,9 +1782,9 @@ void InvalidateByAddr(u32 localAddr)
 
         FastBlockLookupRegions[block->StartAddrLocal >> 27][(block->StartAddrLocal & 0x7FFFFFF) / 2] = (u64)UINT32_MAX << 32;
         if (block->Num == 0)
-            JitBlocks9.erase(block->StartAddr);
+            JitBlocks9.Erase(block->StartAddr);
         else
-            JitBlocks7.erase(block->StartAddr);
+            JitBlocks7.Erase(block->StartAddr);
 
         if (!literalInvalidation)
         {
@@ -1079,7 +1792,7 @@ void InvalidateByAddr(u32 localAddr)
         }
         else
         {
-            delete block;
+            FreeJitBlock(block);
         }
     }
 }
@@ -1150,9 +1863,171 @@ template void CheckAndInvalidate<1, ARMJIT_Memory::memregion_NewSharedWRAM_B>(u3
 template void CheckAndInvalidate<0, ARMJIT_Memory::memregion_NewSharedWRAM_C>(u32);
 template void CheckAndInvalidate<1, ARMJIT_Memory::memregion_NewSharedWRAM_C>(u32);
 
+void UnlinkJitBlock(JitBlock* block)
+{
+    for (int j = 0; j < block->NumAddresses; j++)
+    {
+        u32 addr = block->AddressRanges()[j];
+        AddressRange* region = CodeMemRegions[addr >> 27];
+        AddressRange* range = &region[(addr & 0x7FFFFFF) / 512];
+
+        bool removed = range->Blocks.RemoveByValue(block);
+        assert(removed);
+
+        // the remaining blocks might still cover some of the same code
+        range->Code = 0;
+        for (int k = 0; k < range->Blocks.Length; k++)
+        {
+            JitBlock* other = range->Blocks[k];
+            for (int l = 0; l < other->NumAddresses; l++)
+            {
+                if (other->AddressRanges()[l] == addr)
+                    range->Code |= other->AddressMasks()[l];
+            }
+        }
+
+        if (range->Blocks.Length == 0
+            && !PageContainsCode(&region[(addr & 0x7FFF000) / 512]))
+        {
+            ARMJIT_Memory::SetCodeProtection(addr >> 27, addr & 0x7FFFFFF, false);
+        }
+    }
+
+    // the lookup entry might already belong to a block at another mirror
+    u64* entry = &FastBlockLookupRegions[block->StartAddrLocal >> 27][(block->StartAddrLocal & 0x7FFFFFF) / 2];
+    if ((u32)*entry == JITCompiler->SubEntryOffset(block->EntryPoint))
+        *entry = (u64)UINT32_MAX << 32;
+
+    BlockMap<JitBlock>& map = block->Num == 0 ? JitBlocks9 : JitBlocks7;
+    if (map.Find(block->StartAddr) == block)
+        map.Erase(block->StartAddr);
+}
+
+u32 EvictBlocks(u8* start, u8* end)
+{
+    std::vector<JitBlock*> evicted;
+
+    for (int i = 0; i < 2; i++)
+    {
+        BlockMap<JitBlock>& map = i == 0 ? JitBlocks9 : JitBlocks7;
+        for (u32 j = 0; map.Length && j <= map.Mask; j++)
+        {
+            JitBlock* block = map.Entries[j].Value;
+            if (block && (u8*)block->EntryPoint >= start && (u8*)block->EntryPoint < end)
+                evicted.push_back(block);
+        }
+    }
+    u32 numEvicted = evicted.size();
+    for (JitBlock* block : evicted)
+    {
+        UnlinkJitBlock(block);
+        FreeJitBlock(block);
+    }
+
+    // retired blocks aren't linked anywhere anymore
+    evicted.clear();
+    for (u32 j = 0; RestoreCandidates.Length && j <= RestoreCandidates.Mask; j++)
+    {
+        JitBlock* block = RestoreCandidates.Entries[j].Value;
+        if (block && (u8*)block->EntryPoint >= start && (u8*)block->EntryPoint < end)
+            evicted.push_back(block);
+    }
+    for (JitBlock* block : evicted)
+    {
+        RestoreCandidates.Erase(block->InstrHash);
+        FreeJitBlock(block);
+    }
+
+    Stats.Evictions++;
+    Stats.EvictedBlocks += numEvicted;
+    return numEvicted;
+}
+
+// code ranges (and their contents) remembered before a savestate load
+std::vector<u32> SavedCodeRanges;
+std::vector<u8> SavedCode;
+
+u8* GetCodeRangePtr(u32 localAddr)
+{
+    u32 offset = localAddr & 0x7FFFFFF;
+    switch (localAddr >> 27)
+    {
+    case ARMJIT_Memory::memregion_ITCM: return &NDS::ARM9->ITCM[offset];
+    case ARMJIT_Memory::memregion_MainRAM: return &NDS::MainRAM[offset];
+    case ARMJIT_Memory::memregion_SharedWRAM: return &NDS::SharedWRAM[offset];
+    case ARMJIT_Memory::memregion_WRAM7: return &NDS::ARM7WRAM[offset];
+    case ARMJIT_Memory::memregion_NewSharedWRAM_A: return &DSi::NWRAM_A[offset];
+    case ARMJIT_Memory::memregion_NewSharedWRAM_B: return &DSi::NWRAM_B[offset];
+    case ARMJIT_Memory::memregion_NewSharedWRAM_C: return &DSi::NWRAM_C[offset];
+    }
+
+    // VRAM isn't addressed linearly
+    return NULL;
+}
+
+void PrepareSavestateLoad()
+{
+    SavedCodeRanges.clear();
+    SavedCode.clear();
+
+    for (int i = 0; i < ARMJIT_Memory::memregions_Count; i++)
+    {
+        // the BIOSes aren't part of savestates
+        if (!CodeMemRegions[i]
+            || i == ARMJIT_Memory::memregion_BIOS9 || i == ARMJIT_Memory::memregion_BIOS7
+            || i == ARMJIT_Memory::memregion_BIOS9DSi || i == ARMJIT_Memory::memregion_BIOS7DSi)
+            continue;
+
+        for (u32 j = 0; j < CodeRegionSizes[i] / 512; j++)
+        {
+            if (!CodeMemRegions[i][j].Code)
+                continue;
+
+            u32 localAddr = (i << 27) | (j * 512);
+            SavedCodeRanges.push_back(localAddr);
+
+            u8* ptr = GetCodeRangePtr(localAddr);
+            if (ptr)
+                SavedCode.insert(SavedCode.end(), ptr, ptr + 512);
+        }
+    }
+}
+
+void FinishSavestateLoad()
+{
+    size_t offset = 0;
+    for (u32 localAddr : SavedCodeRanges)
+    {
+        u8* ptr = GetCodeRangePtr(localAddr);
+        if (ptr)
+        {
+            bool changed = memcmp(ptr, &SavedCode[offset], 512) != 0;
+            offset += 512;
+            if (!changed)
+                continue;
+        }
+
+        // blocks which were already invalidated through another range are gone
+        if (CodeMemRegions[localAddr >> 27][(localAddr & 0x7FFFFFF) / 512].Code)
+            InvalidateByAddr(localAddr);
+    }
+
+    SavedCodeRanges.clear();
+    SavedCode.clear();
+}
+
 void ResetBlockCache()
 {
     printf("Resetting JIT block cache...\n");
+    Stats.CacheResets++;
+
+    // wait for the block currently being compiled, everything
+    // else which was queued is simply dropped
+    LockCompiler();
+    JobsQueued = 0;
+    JobsCompiled = 0;
+    JobsPublished = 0;
+    CodeSegmentFull = false;
 
     // could be replace through a function which only resets
     // the permissions but we're too lazy
@@ -1164,37 +2039,30 @@ void ResetBlockCache()
         if (FastBlockLookupRegions[i])
             memset(FastBlockLookupRegions[i], 0xFF, CodeRegionSizes[i] * sizeof(u64) / 2);
     }
-    for (auto it = RestoreCandidates.begin(); it != RestoreCandidates.end(); it++)
-        delete it->second;
-    RestoreCandidates.clear();
-    for (auto it : JitBlocks9)
+    RestoreCandidates.Clear();
+    for (int i = 0; i < 2; i++)
     {
-        JitBlock* block = it.second;
-        for (int j = 0; j < block->NumAddresses; j++)
+        BlockMap<JitBlock>& map = i == 0 ? JitBlocks9 : JitBlocks7;
+        for (u32 j = 0; map.Length && j <= map.Mask; j++)
         {
-            u32 addr = block->AddressRanges()[j];
-            AddressRange* range = &CodeMemRegions[addr >> 27][(addr & 0x7FFFFFF) / 512];
-            range->Blocks.Clear();
-            range->Code = 0;
-        }
-        delete block;
-    }
-    for (auto it : JitBlocks7)
-    {
-        JitBlock* block = it.second;
-        for (int j = 0; j < block->NumAddresses; j++)
-        {
-            u32 addr = block->AddressRanges()[j];
-            AddressRange* range = &CodeMemRegions[addr >> 27][(addr & 0x7FFFFFF) / 512];
-            range->Blocks.Clear();
-            range->Code = 0;
+            JitBlock* block = map.Entries[j].Value;
+            if (!block)
+                continue;
+
+            for (int k = 0; k < block->NumAddresses; k++)
+            {
+                u32 addr = block->AddressRanges()[k];
+                AddressRange* range = &CodeMemRegions[addr >> 27][(addr & 0x7FFFFFF) / 512];
+                range->Blocks.Clear();
+                range->Code = 0;
+            }
         }
-        delete block;
+        map.Clear();
     }
-    JitBlocks9.clear();
-    JitBlocks7.clear();
+    ResetJitBlockPool();
 
     JITCompiler->Reset();
+    UnlockCompiler();
 }
 
 void JitEnableWrite()
@@ -23,6 +23,7 @@
 
 #include "ARM.h"
 #include "ARM_InstrInfo.h"
+#include "ARMJIT_Memory.h"
 
 #if defined(__APPLE__) && defined(__aarch64__)
     #include <pthread.h>
@@ -37,6 +38,30 @@ extern int MaxBlockSize;
 extern bool LiteralOptimizations;
 extern bool BranchOptimizations;
 extern bool FastMemory;
+extern bool AsyncCompilation;
+extern bool TieredCompilation;
+
+// runtime statistics, they're cleared on Reset() and ResetStats()
+// reading and resetting them every frame gives the per frame numbers
+struct Statistics
+{
+    u32 BlocksCompiled;
+    u64 CodeBytes; // emitted for the compiled blocks, not counting slow paths
+    u32 BlocksRestored; // retired blocks which were brought back instead of compiled again
+    u32 RestoreMisses; // retired blocks with a matching hash which couldn't be used anymore
+    u32 BlocksInvalidated[ARMJIT_Memory::memregions_Count]; // by the memory region which was written to
+    u32 FastMemRewrites; // fastmem accesses which faulted and were patched to the slow path
+    u32 SlowReads;
+    u32 SlowWrites;
+    u32 SlowBlockTransfers;
+    u32 CacheResets;
+    u32 Evictions; // code segments which had to be cleared for new code
+    u32 EvictedBlocks;
+    u32 Traces; // blocks which were recompiled as traces after getting hot
+};
+
+const Statistics& GetStats();
+void ResetStats();
 
 void Init();
 void DeInit();
@@ -54,6 +79,12 @@ void CompileBlock(ARM* cpu);
 
 void ResetBlockCache();
 
+// savestate loads overwrite memory without going through the write handlers
+// instead of resetting the whole block cache, the code is remembered before
+// loading and only the blocks whose code changed are invalidated afterwards
+void PrepareSavestateLoad();
+void FinishSavestateLoad();
+
 JitBlockEntry LookUpBlock(u32 num, u64* entries, u32 offset, u32 addr);
 bool SetupExecutableRegion(u32 num, u32 blockAddr, u64*& entry, u32& start, u32& size);
 
@@ -541,22 +541,14 @@ void Compiler::A_Comp_ALUMovOp()
     if (op == 0xF) // MVN
     {
         if (op2.IsImm)
-        {
-            if (CurInstr.Cond() == 0xE)
-                RegCache.PutLiteral(CurInstr.A_Reg(12), ~op2.Imm);
             MOVI2R(rd, ~op2.Imm);
-        }
         else
             ORN(rd, WZR, op2.Reg.Rm, op2.ToArithOption());
     }
     else // MOV
     {
         if (op2.IsImm)
-        {
-            if (CurInstr.Cond() == 0xE)
-                RegCache.PutLiteral(CurInstr.A_Reg(12), op2.Imm);
             MOVI2R(rd, op2.Imm);
-        }
         else
         {
             MOV(rd, op2.Reg.Rm, op2.ToArithOption());
@@ -40,10 +40,6 @@ void Compiler::Comp_JumpTo(u32 addr, bool forceNonConstantCycles)
 
     IrregularCycles = true;
 
-    u32 newPC;
-    u32 cycles = 0;
-    bool setupRegion = false;
-
     if (addr & 0x1 && !Thumb)
     {
         CPSRDirty = true;
@@ -55,104 +51,28 @@ void Compiler::Comp_JumpTo(u32 addr, bool forceNonConstantCycles)
         ANDI2R(RCPSR, RCPSR, ~0x20);
     }
 
+    // the fetch timing at the target was already looked up
+    // together with the instruction
+    u32 cycles = CurInstr.JumpCycles;
+
     if (Num == 0)
     {
-        ARMv5* cpu9 = (ARMv5*)CurCPU;
-
-        u32 oldregion = R15 >> 24;
-        u32 newregion = addr >> 24;
-
-        u32 regionCodeCycles = cpu9->MemTimings[addr >> 12][0];
-        u32 compileTimeCodeCycles = cpu9->RegionCodeCycles;
-        cpu9->RegionCodeCycles = regionCodeCycles;
-
-        MOVI2R(W0, regionCodeCycles);
+        MOVI2R(W0, CurInstr.JumpRegionCodeCycles);
         STR(INDEX_UNSIGNED, W0, RCPU, offsetof(ARMv5, RegionCodeCycles));
-
-        setupRegion = newregion != oldregion;
-        if (setupRegion)
-            cpu9->SetupCodeMem(addr);
-
-        if (addr & 0x1)
-        {
-            addr &= ~0x1;
-            newPC = addr+2;
-
-            // two-opcodes-at-once fetch
-            // doesn't matter if we put garbage in the MSbs there
-            if (addr & 0x2)
-            {
-                cpu9->CodeRead32(addr-2, true) >> 16;
-                cycles += cpu9->CodeCycles;
-                cpu9->CodeRead32(addr+2, false);
-                cycles += CurCPU->CodeCycles;
-            }
-            else
-            {
-                cpu9->CodeRead32(addr, true);
-                cycles += cpu9->CodeCycles;
-            }
-        }
-        else
-        {
-            addr &= ~0x3;
-            newPC = addr+4;
-
-            cpu9->CodeRead32(addr, true);
-            cycles += cpu9->CodeCycles;
-            cpu9->CodeRead32(addr+4, false);
-            cycles += cpu9->CodeCycles;
-        }
-
-        cpu9->RegionCodeCycles = compileTimeCodeCycles;
-        if (setupRegion)
-            cpu9->SetupCodeMem(R15);
     }
     else
     {
-        ARMv4* cpu7 = (ARMv4*)CurCPU;
-
         u32 codeRegion = addr >> 24;
         u32 codeCycles = addr >> 15; // cheato
 
-        cpu7->CodeRegion = codeRegion;
-        cpu7->CodeCycles = codeCycles;
-
         MOVI2R(W0, codeRegion);
         STR(INDEX_UNSIGNED, W0, RCPU, offsetof(ARM, CodeRegion));
         MOVI2R(W0, codeCycles);
         STR(INDEX_UNSIGNED, W0, RCPU, offsetof(ARM, CodeCycles));
-
-        if (addr & 0x1)
-        {
-            addr &= ~0x1;
-            newPC = addr+2;
-
-            // this is necessary because ARM7 bios protection
-            u32 compileTimePC = CurCPU->R[15];
-            CurCPU->R[15] = newPC;
-
-            cycles += NDS::ARM7MemTimings[codeCycles][0] + NDS::ARM7MemTimings[codeCycles][1];
-
-            CurCPU->R[15] = compileTimePC;
-        }
-        else
-        {
-            addr &= ~0x3;
-            newPC = addr+4;
-
-            u32 compileTimePC = CurCPU->R[15];
-            CurCPU->R[15] = newPC;
-
-            cycles += NDS::ARM7MemTimings[codeCycles][2] + NDS::ARM7MemTimings[codeCycles][3];
-
-            CurCPU->R[15] = compileTimePC;
-        }
-
-        cpu7->CodeRegion = R15 >> 24;
-        cpu7->CodeCycles = addr >> 15;
     }
 
+    u32 newPC = addr & 0x1 ? (addr & ~0x1) + 2 : (addr & ~0x3) + 4;
+
     if (Exit)
     {
         MOVI2R(W0, newPC);
@@ -170,8 +90,17 @@ void* Compiler::Gen_JumpTo9(int kind)
     AlignCode16();
     void* res = GetRXPtr();
 
-    LSR(W1, W0, 12);
-    ADDI2R(W1, W1, offsetof(ARMv5, MemTimings), W2);
+    // MemTimingTable[ARM9RegionIndex[addr >> 14]][(PU_Map[addr >> 12] >> 4) & 0x7][0]
+    LSR(W1, W0, 14);
+    MOVP2R(X2, NDS::ARM9RegionIndex);
+    LDRB(W1, X2, ArithOption(W1));
+    LDR(INDEX_UNSIGNED, X2, RCPU, offsetof(ARMv5, PU_Map));
+    LSR(W3, W0, 12);
+    LDRB(W3, X2, ArithOption(W3));
+    UBFX(W3, W3, 4, 3);
+    ADD(W1, W3, W1, ArithOption(W1, ST_LSL, 3));
+    LSL(W1, W1, 2);
+    ADDI2R(W1, W1, offsetof(ARMv5, MemTimingTable), W2);
     LDRB(W1, RCPU, W1);
 
     LDR(INDEX_UNSIGNED, W2, RCPU, offsetof(ARMv5, ITCMSize));
@@ -235,7 +164,9 @@ void* Compiler::Gen_JumpTo7(int kind)
     LSR(W1, W0, 15);
     STR(INDEX_UNSIGNED, W1, RCPU, offsetof(ARM, CodeCycles));
 
-    MOVP2R(X2, NDS::ARM7MemTimings);
+    MOVP2R(X2, NDS::ARM7RegionIndex);
+    LDRB(W1, X2, ArithOption(W1));
+    MOVP2R(X2, NDS::ARM7RegionTimings);
     LDR(W3, X2, ArithOption(W1, true));
 
     FixupBranch switchToThumb;
@@ -378,6 +309,8 @@ void Compiler::T_Comp_B()
 {
     s32 offset = (s32)((CurInstr.Instr & 0x7FF) << 21) >> 20;
     Comp_JumpTo(R15 + offset + 1);
+
+    Comp_BranchSpecialBehaviour(true);
 }
 
 void Compiler::T_Comp_BranchXchangeReg()
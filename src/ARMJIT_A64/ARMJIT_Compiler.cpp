@@ -20,6 +20,7 @@
 
 #include "../ARMJIT_Internal.h"
 #include "../ARMInterpreter.h"
+#include "../ARMJIT_PerfDump.h"
 
 #ifdef __SWITCH__
 #include <switch.h>
@@ -464,6 +465,12 @@ Compiler::Compiler()
     JitMemMainSize -= JitMemSecondarySize;
 
     SetCodeBase((u8*)GetRWPtr(), (u8*)GetRXPtr());
+    SetCodePtr(0);
+    OtherCodeRegion = JitMemMainSize;
+
+    CurCodeSegment = 0;
+    memset(CodeSegmentMainEnd, 0, sizeof(CodeSegmentMainEnd));
+    memset(CodeSegmentSecondaryEnd, 0, sizeof(CodeSegmentSecondaryEnd));
 }
 
 Compiler::~Compiler()
@@ -686,28 +693,40 @@ void Compiler::Comp_BranchSpecialBehaviour(bool taken)
     }
 }
 
-JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemInstr)
+bool Compiler::IsCodeSegmentFull()
 {
-    if (JitMemMainSize - GetCodeOffset() < 1024 * 16)
-    {
-        printf("JIT near memory full, resetting...\n");
-        ResetBlockCache();
-    }
-    if ((JitMemMainSize +  JitMemSecondarySize) - OtherCodeRegion < 1024 * 8)
-    {
-        printf("JIT far memory full, resetting...\n");
-        ResetBlockCache();
-    }
+    return MainSegmentStart(1) - (GetCodeOffset() - MainSegmentStart(CurCodeSegment)) < 1024 * 16
+        || (SecondarySegmentStart(1) - JitMemMainSize) - (OtherCodeRegion - SecondarySegmentStart(CurCodeSegment)) < 1024 * 8;
+}
 
+JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemInstr, JitBlock* profiledBlock,
+    const ARMJIT_Memory::MapState& mapState)
+{
     JitBlockEntry res = (JitBlockEntry)GetRXPtr();
 
     Thumb = thumb;
     Num = cpu->Num;
     CurCPU = cpu;
+    MapState = &mapState;
     ConstantCycles = 0;
     RegCache = RegisterCache<Compiler, ARM64Reg>(this, instrs, instrsCount, true);
     CPSRDirty = false;
 
+    if (profiledBlock)
+    {
+        // stop counting at zero, the block stays hot until it's recompiled
+        MOVP2R(X0, &profiledBlock->ExecCounter);
+        LDR(INDEX_UNSIGNED, W1, X0, 0);
+        FixupBranch alreadyHot = CBZ(W1);
+        SUBS(W1, W1, 1);
+        STR(INDEX_UNSIGNED, W1, X0, 0);
+        FixupBranch notHot = B(CC_NEQ);
+        MOVP2R(X0, profiledBlock);
+        QuickCallFunction(X1, MarkBlockHot);
+        SetJumpTarget(notHot);
+        SetJumpTarget(alreadyHot);
+    }
+
     if (hasMemInstr)
         MOVP2R(RMemBase, Num == 0 ? ARMJIT_Memory::FastMem9Start : ARMJIT_Memory::FastMem7Start);
 
@@ -825,6 +844,12 @@ JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[]
 
         if (comp == NULL)
         {
+            LDR(INDEX_UNSIGNED, W0, RCPU, offsetof(ARM, LazyFlagsOp));
+            FixupBranch flagsDone = CBZ(W0);
+            MOV(X0, RCPU);
+            QuickCallFunction(X1, MaterializeFlags);
+            SetJumpTarget(flagsDone);
+
             LoadCycles();
             LoadCPSR();
         }
@@ -838,26 +863,92 @@ JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[]
 
     FlushIcache();
 
+    LastBlockSize = (u8*)GetRXPtr() - (u8*)res;
+
+#ifdef JIT_PERF_DUMP_ENABLED
+    ARMJIT_PerfDump::RecordBlock(Num, instrs[0].Addr, (void*)res, LastBlockSize);
+#endif
+
     return res;
 }
 
+void Compiler::WipeCode(u32 start, u32 end)
+{
+    const u32 brk_0 = 0xD4200000;
+
+    SetCodePtr(start);
+    for (u32 i = 0; i < (end - start) / 4; i++)
+        *(((u32*)GetWriteableRWPtr()) + i) = brk_0;
+}
+
 void Compiler::Reset()
 {
     LoadStorePatches.clear();
 
+    // only wipe what was emitted since the last reset
+    // the rest of the code memory was never written to, so it doesn't
+    // have to be committed
+    CodeSegmentMainEnd[CurCodeSegment] = GetCodeOffset();
+    CodeSegmentSecondaryEnd[CurCodeSegment] = OtherCodeRegion;
+    for (u32 i = 0; i < CodeSegmentCount; i++)
+    {
+        if (!CodeSegmentSecondaryEnd[i])
+            continue;
+
+        WipeCode(MainSegmentStart(i), CodeSegmentMainEnd[i]);
+        WipeCode(SecondarySegmentStart(i), CodeSegmentSecondaryEnd[i]);
+        CodeSegmentMainEnd[i] = 0;
+        CodeSegmentSecondaryEnd[i] = 0;
+    }
+
+    CurCodeSegment = 0;
     SetCodePtr(0);
     OtherCodeRegion = JitMemMainSize;
+}
 
-    const u32 brk_0 = 0xD4200000;
+void Compiler::NextCodeSegment()
+{
+    CodeSegmentMainEnd[CurCodeSegment] = GetCodeOffset();
+    CodeSegmentSecondaryEnd[CurCodeSegment] = OtherCodeRegion;
+
+    CurCodeSegment = (CurCodeSegment + 1) % CodeSegmentCount;
+    u32 mainStart = MainSegmentStart(CurCodeSegment);
+    u32 secondaryStart = SecondarySegmentStart(CurCodeSegment);
+
+    // the secondary end is never 0 for a segment which was used
+    if (CodeSegmentSecondaryEnd[CurCodeSegment])
+    {
+        // the oldest segment gets reused, so everything in it has to go
+        u32 mainEnd = CodeSegmentMainEnd[CurCodeSegment];
+        u32 secondaryEnd = CodeSegmentSecondaryEnd[CurCodeSegment];
+
+        u32 evicted = EvictBlocks(GetRXBase() + mainStart, GetRXBase() + mainEnd);
+        printf("JIT code memory full, evicted %d blocks\n", evicted);
+
+        for (auto it = LoadStorePatches.begin(); it != LoadStorePatches.end();)
+        {
+            if (it->first >= mainStart && it->first < mainEnd)
+                it = LoadStorePatches.erase(it);
+            else
+                it++;
+        }
+
+        WipeCode(mainStart, mainEnd);
+        FlushIcacheSection(GetRXBase() + mainStart, GetRXBase() + mainEnd);
+        WipeCode(secondaryStart, secondaryEnd);
+        FlushIcacheSection(GetRXBase() + secondaryStart, GetRXBase() + secondaryEnd);
+        CodeSegmentMainEnd[CurCodeSegment] = 0;
+        CodeSegmentSecondaryEnd[CurCodeSegment] = 0;
+    }
 
-    for (int i = 0; i < (JitMemMainSize + JitMemSecondarySize) / 4; i++)
-        *(((u32*)GetRWPtr()) + i) = brk_0;
+    SetCodePtr(mainStart);
+    OtherCodeRegion = secondaryStart;
 }
 
 void Compiler::Comp_AddCycles_C(bool forceNonConstant)
 {
     s32 cycles = Num ?
-        NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 1 : 3]
+        CurInstr.SeqCodeCycles
         : ((R15 & 0x2) ? 0 : CurInstr.CodeCycles);
 
     if (forceNonConstant)
@@ -871,7 +962,7 @@ void Compiler::Comp_AddCycles_CI(u32 numI)
     IrregularCycles = true;
 
     s32 cycles = (Num ?
-        NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2]
+        CurInstr.NonseqCodeCycles
         : ((R15 & 0x2) ? 0 : CurInstr.CodeCycles)) + numI;
 
     if (Thumb || CurInstr.Cond() == 0xE)
@@ -885,7 +976,7 @@ void Compiler::Comp_AddCycles_CI(u32 c, ARM64Reg numI, ArithOption shift)
     IrregularCycles = true;
 
     s32 cycles = (Num ?
-        NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2]
+        CurInstr.NonseqCodeCycles
         : ((R15 & 0x2) ? 0 : CurInstr.CodeCycles)) + c;
 
     ADD(RCycles, RCycles, cycles);
@@ -905,7 +996,7 @@ void Compiler::Comp_AddCycles_CDI()
 
         s32 cycles;
 
-        s32 numC = NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2];
+        s32 numC = CurInstr.NonseqCodeCycles;
         s32 numD = CurInstr.DataCycles;
 
         if ((CurInstr.DataRegion >> 24) == 0x02) // mainRAM
@@ -950,7 +1041,7 @@ void Compiler::Comp_AddCycles_CD()
     }
     else
     {
-        s32 numC = NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2];
+        s32 numC = CurInstr.NonseqCodeCycles;
         s32 numD = CurInstr.DataCycles;
 
         if ((CurInstr.DataRegion >> 24) == 0x02)
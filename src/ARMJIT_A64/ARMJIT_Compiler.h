@@ -25,6 +25,7 @@
 #include "../dolphin/Arm64Emitter.h"
 
 #include "../ARMJIT_Internal.h"
+#include "../ARMJIT_Memory.h"
 #include "../ARMJIT_RegisterCache.h"
 
 #include <unordered_map>
@@ -109,7 +110,15 @@ public:
         return RegCache.Mapping[reg];
     }
 
-    JitBlockEntry CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemInstr);
+    // has to be checked before compiling a block, moving on to the next
+    // segment evicts all the blocks in it
+    bool IsCodeSegmentFull();
+    // profiledBlock is the block whose executions are counted, NULL if none
+    // mapState is the memory map as it was when the block was fetched
+    JitBlockEntry CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemInstr, JitBlock* profiledBlock,
+        const ARMJIT_Memory::MapState& mapState);
+    // size of the code emitted by the last call to CompileBlock
+    u32 LastBlockSize;
 
     bool CanCompile(bool thumb, u16 kind);
 
@@ -205,7 +214,7 @@ public:
     void Comp_RegShiftImm(int op, int amount, bool S, Op2& op2, Arm64Gen::ARM64Reg tmp = Arm64Gen::W0);
     void Comp_RegShiftReg(int op, bool S, Op2& op2, Arm64Gen::ARM64Reg rs);
 
-    bool Comp_MemLoadLiteral(int size, bool signExtend, int rd, u32 addr);
+    bool Comp_MemLoadLiteral(int rd);
 
     enum
     {
@@ -252,6 +261,7 @@ public:
     u32 R15;
     u32 Num;
     ARM* CurCPU;
+    const ARMJIT_Memory::MapState* MapState;
     u32 ConstantCycles;
     u32 CodeRegion;
 
@@ -260,6 +270,21 @@ public:
     u32 JitMemSecondarySize;
     u32 JitMemMainSize;
 
+    // both code regions are split into segments, which are filled
+    // one after another. once all are used the oldest one is evicted
+    static const u32 CodeSegmentCount = 8;
+    u32 CurCodeSegment;
+    u32 CodeSegmentMainEnd[CodeSegmentCount];
+    u32 CodeSegmentSecondaryEnd[CodeSegmentCount];
+
+    u32 MainSegmentStart(u32 segment)
+    { return segment * ((JitMemMainSize / CodeSegmentCount) & ~3); }
+    u32 SecondarySegmentStart(u32 segment)
+    { return JitMemMainSize + segment * ((JitMemSecondarySize / CodeSegmentCount) & ~3); }
+
+    void WipeCode(u32 start, u32 end);
+    void NextCodeSegment();
+
     std::unordered_map<ptrdiff_t, LoadStorePatch> LoadStorePatches; 
 
     RegisterCache<Compiler, Arm64Gen::ARM64Reg> RegCache;
@@ -60,46 +60,17 @@ u8* Compiler::RewriteMemAccess(u8* pc)
     abort();
 }
 
-bool Compiler::Comp_MemLoadLiteral(int size, bool signExtend, int rd, u32 addr)
+bool Compiler::Comp_MemLoadLiteral(int rd)
 {
-    u32 localAddr = LocaliseCodeAddress(Num, addr);
-
-    int invalidLiteralIdx = InvalidLiterals.Find(localAddr);
-    if (invalidLiteralIdx != -1)
+    if (!CurInstr.HasLiteral)
     {
         return false;
     }
 
     Comp_AddCycles_CDI();
 
-    u32 val;
-    // make sure arm7 bios is accessible
-    u32 tmpR15 = CurCPU->R[15];
-    CurCPU->R[15] = R15;
-    if (size == 32)
-    {
-        CurCPU->DataRead32(addr & ~0x3, &val);
-        val = ::ROR(val, (addr & 0x3) << 3);
-    }
-    else if (size == 16)
-    {
-        CurCPU->DataRead16(addr & ~0x1, &val);
-        if (signExtend)
-            val = ((s32)val << 16) >> 16;
-    }
-    else
-    {
-        CurCPU->DataRead8(addr, &val);
-        if (signExtend)
-            val = ((s32)val << 24) >> 24;
-    }
-    CurCPU->R[15] = tmpR15;
+    MOVI2R(MapReg(rd), CurInstr.LiteralValue);
 
-    MOVI2R(MapReg(rd), val);
-
-    if (Thumb || CurInstr.Cond() == 0xE)
-        RegCache.PutLiteral(rd, val);
-    
     return true;
 }
 
@@ -113,9 +84,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
 
     if (ARMJIT::LiteralOptimizations && rn == 15 && rd != 15 && offset.IsImm && !(flags & (memop_Post|memop_Store|memop_Writeback)))
     {
-        u32 addr = R15 + offset.Imm * ((flags & memop_SubtractOffset) ? -1 : 1);
-        
-        if (Comp_MemLoadLiteral(size, flags & memop_SignExtend, rd, addr))
+        if (Comp_MemLoadLiteral(rd))
             return;
     }
     
@@ -150,7 +119,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
         && RegCache.IsLiteral(rn) && offset.IsImm && !(flags & (memop_Writeback|memop_Post));
     u32 staticAddress;
     if (addrIsStatic)
-        staticAddress = RegCache.LiteralValues[rn] + offset.Imm * ((flags & memop_SubtractOffset) ? -1 : 1);
+        staticAddress = RegCache.LiteralValue(rn) + offset.Imm * ((flags & memop_SubtractOffset) ? -1 : 1);
 
     if (!offset.IsImm)
         Comp_RegShiftImm(offset.Reg.ShiftType, offset.Reg.ShiftAmount, false, offset, W2);
@@ -185,18 +154,35 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
         MOV(rnMapped, W0);
 
     u32 expectedTarget = Num == 0
-        ? ARMJIT_Memory::ClassifyAddress9(addrIsStatic ? staticAddress : CurInstr.DataRegion)
-        : ARMJIT_Memory::ClassifyAddress7(addrIsStatic ? staticAddress : CurInstr.DataRegion);
+        ? ARMJIT_Memory::ClassifyAddress9(*MapState, addrIsStatic ? staticAddress : CurInstr.DataRegion)
+        : ARMJIT_Memory::ClassifyAddress7(*MapState, addrIsStatic ? staticAddress : CurInstr.DataRegion);
+
+    void* ioVar = NULL;
+    int ioVarSize;
+    if (addrIsStatic && !(flags & memop_Store))
+        ioVar = ARMJIT_Memory::GetInlinableIORead(*MapState, CurCPU, staticAddress, size, ioVarSize);
 
-    if (ARMJIT::FastMemory && ((!Thumb && CurInstr.Cond() != 0xE) || ARMJIT_Memory::IsFastmemCompatible(expectedTarget)))
+    if (ioVar)
+    {
+        MOVP2R(X1, ioVar);
+
+        int bits = std::min(size, ioVarSize);
+        if (bits == 32)
+            LDR(INDEX_UNSIGNED, rdMapped, X1, 0);
+        else if (flags & memop_SignExtend)
+            LDRSH(INDEX_UNSIGNED, rdMapped, X1, 0);
+        else
+            LDRH(INDEX_UNSIGNED, rdMapped, X1, 0);
+    }
+    else if (ARMJIT::FastMemory && ((!Thumb && CurInstr.Cond() != 0xE) || ARMJIT_Memory::IsFastmemCompatible(expectedTarget)))
     {
         ptrdiff_t memopStart = GetCodeOffset();
         LoadStorePatch patch;
 
         assert((rdMapped >= W8 && rdMapped <= W15) || (rdMapped >= W19 && rdMapped <= W25) || rdMapped == W4);
         patch.PatchFunc = flags & memop_Store
-            ? PatchedStoreFuncs[NDS::ConsoleType][Num][__builtin_ctz(size) - 3][rdMapped]
-            : PatchedLoadFuncs[NDS::ConsoleType][Num][__builtin_ctz(size) - 3][!!(flags & memop_SignExtend)][rdMapped];
+            ? PatchedStoreFuncs[MapState->ConsoleType][Num][__builtin_ctz(size) - 3][rdMapped]
+            : PatchedLoadFuncs[MapState->ConsoleType][Num][__builtin_ctz(size) - 3][!!(flags & memop_SignExtend)][rdMapped];
 
         // take a chance at fastmem
         if (size > 8)
@@ -225,7 +211,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
     {
         void* func = NULL;
         if (addrIsStatic)
-            func = ARMJIT_Memory::GetFuncForAddr(CurCPU, staticAddress, flags & memop_Store, size);
+            func = ARMJIT_Memory::GetFuncForAddr(*MapState, CurCPU, staticAddress, flags & memop_Store, size);
 
         PushRegs(false, false);
 
@@ -263,7 +249,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
                 if (flags & memop_Store)
                 {
                     MOV(W2, rdMapped);
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: QuickCallFunction(X3, SlowWrite9<u32, 0>); break;
                     case 33: QuickCallFunction(X3, SlowWrite9<u32, 1>); break;
@@ -275,7 +261,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
                 }
                 else
                 {
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: QuickCallFunction(X3, SlowRead9<u32, 0>); break;
                     case 33: QuickCallFunction(X3, SlowRead9<u32, 1>); break;
@@ -291,7 +277,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
                 if (flags & memop_Store)
                 {
                     MOV(W1, rdMapped);
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: QuickCallFunction(X3, SlowWrite7<u32, 0>); break;
                     case 33: QuickCallFunction(X3, SlowWrite7<u32, 1>); break;
@@ -303,7 +289,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, Op2 offset, int size, int flags)
                 }
                 else
                 {
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: QuickCallFunction(X3, SlowRead7<u32, 0>); break;
                     case 33: QuickCallFunction(X3, SlowRead7<u32, 1>); break;
@@ -450,9 +436,8 @@ void Compiler::T_Comp_MemImmHalf()
 void Compiler::T_Comp_LoadPCRel()
 {
     u32 offset = ((CurInstr.Instr & 0xFF) << 2);
-    u32 addr = (R15 & ~0x2) + offset;
 
-    if (!ARMJIT::LiteralOptimizations || !Comp_MemLoadLiteral(32, false, CurInstr.T_Reg(8), addr))
+    if (!ARMJIT::LiteralOptimizations || !Comp_MemLoadLiteral(CurInstr.T_Reg(8)))
         Comp_MemAccess(CurInstr.T_Reg(8), 15, Op2(offset), 32, 0);
 }
 
@@ -494,8 +479,8 @@ s32 Compiler::Comp_MemAccessBlock(int rn, BitSet16 regs, bool store, bool preinc
         Comp_AddCycles_CDI();
 
     int expectedTarget = Num == 0
-        ? ARMJIT_Memory::ClassifyAddress9(CurInstr.DataRegion)
-        : ARMJIT_Memory::ClassifyAddress7(CurInstr.DataRegion);
+        ? ARMJIT_Memory::ClassifyAddress9(*MapState, CurInstr.DataRegion)
+        : ARMJIT_Memory::ClassifyAddress7(*MapState, CurInstr.DataRegion);
 
     bool compileFastPath = ARMJIT::FastMemory
         && store && !usermode && (CurInstr.Cond() < 0xE || ARMJIT_Memory::IsFastmemCompatible(expectedTarget));
@@ -680,7 +665,7 @@ s32 Compiler::Comp_MemAccessBlock(int rn, BitSet16 regs, bool store, bool preinc
     if (Num == 0)
     {
         MOV(X3, RCPU);
-        switch ((u32)store * 2 | NDS::ConsoleType)
+        switch ((u32)store * 2 | MapState->ConsoleType)
         {
         case 0: QuickCallFunction(X4, SlowBlockTransfer9<false, 0>); break;
         case 1: QuickCallFunction(X4, SlowBlockTransfer9<false, 1>); break;
@@ -690,7 +675,7 @@ s32 Compiler::Comp_MemAccessBlock(int rn, BitSet16 regs, bool store, bool preinc
     }
     else
     {
-        switch ((u32)store * 2 | NDS::ConsoleType)
+        switch ((u32)store * 2 | MapState->ConsoleType)
         {
         case 0: QuickCallFunction(X4, SlowBlockTransfer7<false, 0>); break;
         case 1: QuickCallFunction(X4, SlowBlockTransfer7<false, 1>); break;
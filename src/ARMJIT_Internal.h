@@ -66,6 +66,18 @@ struct FetchedInstr
     u16 CodeCycles;
     u32 DataRegion;
 
+    // looked up while fetching the block, so that compiling it
+    // doesn't have to touch the CPU state
+    bool HasLiteral;
+    u32 LiteralValue; // the value loaded, already rotated or masked
+    u8 JumpRegionCodeCycles;
+    u16 JumpCycles; // fetch cycles after a branch to a static target
+    u8 NonseqCodeCycles, SeqCodeCycles; // ARM7 only, CodeCycles is the page then
+
+    // filled in by PropagateConstants
+    u16 KnownRegs; // registers holding a constant before this instruction
+    u32 ConstResult; // value written to the destination register, if it's constant
+
     ARMInstrInfo::Info Info;
 };
 
@@ -171,15 +183,153 @@ struct __attribute__((packed)) TinyVector
     }
 };
 
+/*
+    BlockMap
+        - maps u32 keys to pointers, for block addresses and instruction hashes
+
+    - open addressing with linear probing, in one flat array
+    - null values mark empty slots
+    - erasing shifts the following entries back, so there are no tombstones
+    - grows when half full, never shrinks
+*/
+template <typename T>
+struct BlockMap
+{
+    struct Entry
+    {
+        u32 Key;
+        T* Value;
+    };
+
+    Entry* Entries = NULL;
+    u32 Mask = 0;
+    u32 Shift = 32;
+    u32 Length = 0;
+
+    ~BlockMap()
+    {
+        delete[] Entries;
+    }
+
+    u32 Slot(u32 key) const
+    {
+        // fibonacci hashing, the low bits of block addresses are mostly the same
+        return (key * 0x9E3779B1) >> Shift;
+    }
+
+    T* Find(u32 key) const
+    {
+        if (!Entries)
+            return NULL;
+
+        for (u32 i = Slot(key);; i = (i + 1) & Mask)
+        {
+            if (!Entries[i].Value)
+                return NULL;
+            if (Entries[i].Key == key)
+                return Entries[i].Value;
+        }
+    }
+
+    // returns the value which was previously mapped to key, if any
+    T* Insert(u32 key, T* value)
+    {
+        assert(value);
+        if ((Length + 1) * 2 > Mask + 1)
+            Grow();
+
+        u32 i = Slot(key);
+        while (Entries[i].Value)
+        {
+            if (Entries[i].Key == key)
+            {
+                T* prev = Entries[i].Value;
+                Entries[i].Value = value;
+                return prev;
+            }
+            i = (i + 1) & Mask;
+        }
+
+        Entries[i].Key = key;
+        Entries[i].Value = value;
+        Length++;
+        return NULL;
+    }
+
+    // returns the removed value, if any
+    T* Erase(u32 key)
+    {
+        if (!Entries)
+            return NULL;
+
+        u32 i = Slot(key);
+        while (Entries[i].Key != key || !Entries[i].Value)
+        {
+            if (!Entries[i].Value)
+                return NULL;
+            i = (i + 1) & Mask;
+        }
+        T* value = Entries[i].Value;
+
+        // move back every following entry which would be unreachable otherwise
+        for (u32 j = (i + 1) & Mask; Entries[j].Value; j = (j + 1) & Mask)
+        {
+            u32 home = Slot(Entries[j].Key);
+            if (((j - home) & Mask) >= ((j - i) & Mask))
+            {
+                Entries[i] = Entries[j];
+                i = j;
+            }
+        }
+        Entries[i].Value = NULL;
+        Length--;
+        return value;
+    }
+
+    void Clear()
+    {
+        if (Entries)
+            memset(Entries, 0, sizeof(Entry) * (Mask + 1));
+        Length = 0;
+    }
+
+    void Grow()
+    {
+        Entry* oldEntries = Entries;
+        u32 oldSize = Entries ? Mask + 1 : 0;
+
+        u32 size = oldSize ? oldSize * 2 : 1024;
+        Entries = new Entry[size];
+        memset(Entries, 0, sizeof(Entry) * size);
+        Mask = size - 1;
+        Shift = 32 - __builtin_ctz(size);
+
+        for (u32 i = 0; i < oldSize; i++)
+        {
+            if (!oldEntries[i].Value)
+                continue;
+
+            u32 j = Slot(oldEntries[i].Key);
+            while (Entries[j].Value)
+                j = (j + 1) & Mask;
+            Entries[j] = oldEntries[i];
+        }
+
+        delete[] oldEntries;
+    }
+};
+
 class JitBlock
 {
 public:
-    JitBlock(u32 num, u32 literalHash, u32 numAddresses, u32 numLiterals)
+    JitBlock(u32 num, u32 numAddresses, u32 numLiterals)
     {
         Num = num;
         NumAddresses = numAddresses;
         NumLiterals = numLiterals;
-        Data.SetLength(numAddresses * 2 + numLiterals);
+        EntryPoint = NULL;
+        ExecCounter = 0;
+        Profiled = false;
     }
 
     u32 StartAddr;
@@ -191,17 +341,41 @@ public:
 
     JitBlockEntry EntryPoint;
 
+    // profiled blocks count down each time they're entered,
+    // reaching zero makes them get recompiled as a trace (tier 2)
+    u32 ExecCounter;
+    bool Profiled;
+
+    // the address ranges, masks and literals are stored right after the block
     u32* AddressRanges()
-    { return &Data[0]; }
+    { return Data(); }
     u32* AddressMasks()
-    { return &Data[NumAddresses]; }
+    { return Data() + NumAddresses; }
     u32* Literals()
-    { return &Data[NumAddresses * 2]; }
+    { return Data() + NumAddresses * 2; }
 
 private:
-    TinyVector<u32> Data;
+    u32* Data()
+    { return (u32*)(this + 1); }
 };
 
+// blocks are allocated from a pool, so recompiling doesn't hit the heap
+JitBlock* AllocJitBlock(u32 num, u32 numAddresses, u32 numLiterals);
+void FreeJitBlock(JitBlock* block);
+
+// called by profiled blocks once their counter runs out
+void MarkBlockHot(JitBlock* block);
+
+// drops every block whose code starts within [start, end)
+// used by the compilers to reuse parts of the code memory
+u32 EvictBlocks(u8* start, u8* end);
+
+// with background compilation the compiler might be busy on another thread
+void LockCompiler();
+void UnlockCompiler();
+
+extern Statistics Stats;
+
 // size should be 16 bytes because I'm to lazy to use mul and whatnot
 struct __attribute__((packed)) AddressRange
 {
@@ -214,6 +388,10 @@ typedef void (*InterpreterFunc)(ARM* cpu);
 extern InterpreterFunc InterpretARM[];
 extern InterpreterFunc InterpretTHUMB[];
 
+// the interpreter only records how it set the flags,
+// called after it returns to compiled code
+void MaterializeFlags(ARM* cpu);
+
 extern TinyVector<u32> InvalidLiterals;
 
 extern AddressRange* const CodeMemRegions[ARMJIT_Memory::memregions_Count];
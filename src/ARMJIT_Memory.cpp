@@ -686,7 +686,13 @@ bool FaultHandler(FaultDescription& faultDesc)
             rewriteToSlowPath = !MapAtAddress(faultDesc.EmulatedFaultAddr);
 
         if (rewriteToSlowPath)
+        {
+            // this thread can't be holding the lock while it's running JIT code
+            ARMJIT::LockCompiler();
             faultDesc.FaultPC = ARMJIT::JITCompiler->RewriteMemAccess(faultDesc.FaultPC);
+            ARMJIT::UnlockCompiler();
+            ARMJIT::Stats.FastMemRewrites++;
+        }
 
         return true;
     }
@@ -850,6 +856,33 @@ void Reset()
     printf("done resetting jit mem\n");
 }
 
+const char* RegionNames[memregions_Count] =
+{
+    "other",
+    "ITCM",
+    "DTCM",
+    "BIOS9",
+    "main RAM",
+    "shared WRAM",
+    "IO9",
+    "VRAM",
+    "BIOS7",
+    "WRAM7",
+    "IO7",
+    "wifi",
+    "VWRAM",
+    "BIOS9 (DSi)",
+    "BIOS7 (DSi)",
+    "NWRAM A",
+    "NWRAM B",
+    "NWRAM C",
+};
+
+const char* GetRegionName(int region)
+{
+    return RegionNames[region];
+}
+
 bool IsFastmemCompatible(int region)
 {
 #ifdef _WIN32
@@ -1063,21 +1096,35 @@ u32 LocaliseAddress(int region, u32 num, u32 addr)
     }
 }
 
-int ClassifyAddress9(u32 addr)
+void GetMapState(MapState& state)
+{
+    state.ConsoleType = NDS::ConsoleType;
+    state.ITCMSize = NDS::ARM9->ITCMSize;
+    state.DTCMBase = NDS::ARM9->DTCMBase;
+    state.DTCMMask = NDS::ARM9->DTCMMask;
+    state.SCFG_BIOS = DSi::SCFG_BIOS;
+    state.ExMemCnt9 = NDS::ExMemCnt[0];
+    state.SWRAMMapped[0] = NDS::SWRAM_ARM9.Mem != NULL;
+    state.SWRAMMapped[1] = NDS::SWRAM_ARM7.Mem != NULL;
+    memcpy(state.NWRAMStart, DSi::NWRAMStart, sizeof(state.NWRAMStart));
+    memcpy(state.NWRAMEnd, DSi::NWRAMEnd, sizeof(state.NWRAMEnd));
+}
+
+int ClassifyAddress9(const MapState& state, u32 addr)
 {
-    if (addr < NDS::ARM9->ITCMSize)
+    if (addr < state.ITCMSize)
     {
         return memregion_ITCM;
     }
-    else if ((addr & NDS::ARM9->DTCMMask) == NDS::ARM9->DTCMBase)
+    else if ((addr & state.DTCMMask) == state.DTCMBase)
     {
         return memregion_DTCM;
     }
     else
     {
-        if (NDS::ConsoleType == 1 && addr >= 0xFFFF0000 && !(DSi::SCFG_BIOS & (1<<1)))
+        if (state.ConsoleType == 1 && addr >= 0xFFFF0000 && !(state.SCFG_BIOS & (1<<1)))
         {
-            if ((addr >= 0xFFFF8000) && (DSi::SCFG_BIOS & (1<<0)))
+            if ((addr >= 0xFFFF8000) && (state.SCFG_BIOS & (1<<0)))
                 return memregion_Other;
 
             return memregion_BIOS9DSi;
@@ -1092,17 +1139,17 @@ int ClassifyAddress9(u32 addr)
         case 0x02000000:
             return memregion_MainRAM;
         case 0x03000000:
-            if (NDS::ConsoleType == 1)
+            if (state.ConsoleType == 1)
             {
-                if (addr >= DSi::NWRAMStart[0][0] && addr < DSi::NWRAMEnd[0][0])
+                if (addr >= state.NWRAMStart[0][0] && addr < state.NWRAMEnd[0][0])
                     return memregion_NewSharedWRAM_A;
-                if (addr >= DSi::NWRAMStart[0][1] && addr < DSi::NWRAMEnd[0][1])
+                if (addr >= state.NWRAMStart[0][1] && addr < state.NWRAMEnd[0][1])
                     return memregion_NewSharedWRAM_B;
-                if (addr >= DSi::NWRAMStart[0][2] && addr < DSi::NWRAMEnd[0][2])
+                if (addr >= state.NWRAMStart[0][2] && addr < state.NWRAMEnd[0][2])
                     return memregion_NewSharedWRAM_C;
             }
 
-            if (NDS::SWRAM_ARM9.Mem)
+            if (state.SWRAMMapped[0])
                 return memregion_SharedWRAM;
             return memregion_Other;
         case 0x04000000:
@@ -1115,11 +1162,11 @@ int ClassifyAddress9(u32 addr)
     }
 }
 
-int ClassifyAddress7(u32 addr)
+int ClassifyAddress7(const MapState& state, u32 addr)
 {
-    if (NDS::ConsoleType == 1 && addr < 0x00010000 && !(DSi::SCFG_BIOS & (1<<9)))
+    if (state.ConsoleType == 1 && addr < 0x00010000 && !(state.SCFG_BIOS & (1<<9)))
     {
-        if (addr >= 0x00008000 && DSi::SCFG_BIOS & (1<<8))
+        if (addr >= 0x00008000 && state.SCFG_BIOS & (1<<8))
             return memregion_Other;
 
         return memregion_BIOS7DSi;
@@ -1136,17 +1183,17 @@ int ClassifyAddress7(u32 addr)
         case 0x02800000:
             return memregion_MainRAM;
         case 0x03000000:
-            if (NDS::ConsoleType == 1)
+            if (state.ConsoleType == 1)
             {
-                if (addr >= DSi::NWRAMStart[1][0] && addr < DSi::NWRAMEnd[1][0])
+                if (addr >= state.NWRAMStart[1][0] && addr < state.NWRAMEnd[1][0])
                     return memregion_NewSharedWRAM_A;
-                if (addr >= DSi::NWRAMStart[1][1] && addr < DSi::NWRAMEnd[1][1])
+                if (addr >= state.NWRAMStart[1][1] && addr < state.NWRAMEnd[1][1])
                     return memregion_NewSharedWRAM_B;
-                if (addr >= DSi::NWRAMStart[1][2] && addr < DSi::NWRAMEnd[1][2])
+                if (addr >= state.NWRAMStart[1][2] && addr < state.NWRAMEnd[1][2])
                     return memregion_NewSharedWRAM_C;
             }
 
-            if (NDS::SWRAM_ARM7.Mem)
+            if (state.SWRAMMapped[1])
                 return memregion_SharedWRAM;
             return memregion_WRAM7;
         case 0x03800000:
@@ -1165,6 +1212,20 @@ int ClassifyAddress7(u32 addr)
     }
 }
 
+int ClassifyAddress9(u32 addr)
+{
+    MapState state;
+    GetMapState(state);
+    return ClassifyAddress9(state, addr);
+}
+
+int ClassifyAddress7(u32 addr)
+{
+    MapState state;
+    GetMapState(state);
+    return ClassifyAddress7(state, addr);
+}
+
 void WifiWrite32(u32 addr, u32 val)
 {
     Wifi::Write(addr, val & 0xFFFF);
@@ -1201,14 +1262,55 @@ T VRAMRead(u32 addr)
     }
 }
 
-void* GetFuncForAddr(ARM* cpu, u32 addr, bool store, int size)
+/*
+    IO registers which are read straight from a global without any side effects
+    can be loaded inline by the compiled code instead of calling into the
+    IO handlers. varSize is the size of the backing variable in bits,
+    which can be larger than the register itself.
+*/
+void* GetInlinableIORead(const MapState& state, ARM* cpu, u32 addr, int size, int& varSize)
+{
+    int num = cpu->Num;
+    if (num == 0 ? ClassifyAddress9(state, addr) != memregion_IO9 : ClassifyAddress7(state, addr) != memregion_IO7)
+        return NULL;
+
+    if (size == 16)
+    {
+        switch (addr)
+        {
+        case 0x04000004: varSize = 16; return &GPU::DispStat[num];
+        case 0x04000006: varSize = 16; return &GPU::VCount;
+        case 0x04000208: varSize = 32; return &NDS::IME[num];
+        case 0x04000210: varSize = 32; return &NDS::IE[num];
+        }
+    }
+    else if (size == 32)
+    {
+        switch (addr)
+        {
+        case 0x04000208: varSize = 32; return &NDS::IME[num];
+        case 0x04000210: varSize = 32; return &NDS::IE[num];
+        case 0x04000214: varSize = 32; return &NDS::IF[num];
+        }
+    }
+
+    if (size >= 16 && addr == 0x04000180)
+    {
+        varSize = 16;
+        return num == 0 ? &NDS::IPCSync9 : &NDS::IPCSync7;
+    }
+
+    return NULL;
+}
+
+void* GetFuncForAddr(const MapState& state, ARM* cpu, u32 addr, bool store, int size)
 {
     if (cpu->Num == 0)
     {
         switch (addr & 0xFF000000)
         {
         case 0x04000000:
-            if (!store && size == 32 && addr == 0x04100010 && NDS::ExMemCnt[0] & (1<<11))
+            if (!store && size == 32 && addr == 0x04100010 && state.ExMemCnt9 & (1<<11))
                 return (void*)NDSCart::ReadROMData;
 
             /*
@@ -1230,7 +1332,7 @@ void* GetFuncForAddr(ARM* cpu, u32 addr, bool store, int size)
                 }
             }
 
-            if (NDS::ConsoleType == 0)
+            if (state.ConsoleType == 0)
             {
                 switch (size | store)
                 {
@@ -1286,7 +1388,7 @@ void* GetFuncForAddr(ARM* cpu, u32 addr, bool store, int size)
                 }
             }
 
-            if (NDS::ConsoleType == 0)
+            if (state.ConsoleType == 0)
             {
                 switch (size | store)
                 {
@@ -60,6 +60,27 @@ enum
     memregions_Count
 };
 
+const char* GetRegionName(int region);
+
+// everything deciding where an access ends up. Blocks compiled in the
+// background work on a copy taken when they were fetched, since the
+// emulation thread can change the live state at any time
+struct MapState
+{
+    int ConsoleType;
+    u32 ITCMSize;
+    u32 DTCMBase, DTCMMask;
+    u16 SCFG_BIOS;
+    u16 ExMemCnt9;
+    bool SWRAMMapped[2];
+    u32 NWRAMStart[2][3];
+    u32 NWRAMEnd[2][3];
+};
+
+void GetMapState(MapState& state);
+
+int ClassifyAddress9(const MapState& state, u32 addr);
+int ClassifyAddress7(const MapState& state, u32 addr);
 int ClassifyAddress9(u32 addr);
 int ClassifyAddress7(u32 addr);
 
@@ -74,7 +95,8 @@ void RemapNWRAM(int num);
 
 void SetCodeProtection(int region, u32 offset, bool protect);
 
-void* GetFuncForAddr(ARM* cpu, u32 addr, bool store, int size);
+void* GetFuncForAddr(const MapState& state, ARM* cpu, u32 addr, bool store, int size);
+void* GetInlinableIORead(const MapState& state, ARM* cpu, u32 addr, int size, int& varSize);
 
 }
 
@@ -0,0 +1,171 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include "ARMJIT_PerfDump.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace ARMJIT_PerfDump
+{
+
+// the format is described in tools/perf/Documentation/jitdump-specification.txt
+struct FileHeader
+{
+    u32 Magic;
+    u32 Version;
+    u32 TotalSize;
+    u32 ElfMach;
+    u32 Pad1;
+    u32 Pid;
+    u64 Timestamp;
+    u64 Flags;
+};
+
+struct RecordHeader
+{
+    u32 ID;
+    u32 TotalSize;
+    u64 Timestamp;
+};
+
+// followed by the null terminated name and the code itself
+struct CodeLoadRecord
+{
+    RecordHeader Header;
+    u32 Pid;
+    u32 Tid;
+    u64 VMA;
+    u64 CodeAddr;
+    u64 CodeSize;
+    u64 CodeIndex;
+};
+
+enum
+{
+    record_CodeLoad = 0,
+    record_CodeClose = 3,
+};
+
+FILE* DumpFile = NULL;
+void* Marker = NULL;
+size_t MarkerSize;
+u32 Pid;
+u64 CodeIndex;
+
+u64 Timestamp()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void Init()
+{
+    Pid = getpid();
+    CodeIndex = 0;
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/jit-%u.dump", Pid);
+
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0666);
+    if (fd < 0)
+    {
+        printf("PerfDump: couldn't create %s\n", path);
+        return;
+    }
+
+    FileHeader header = {0};
+    header.Magic = 0x4A695444;
+    header.Version = 1;
+    header.TotalSize = sizeof(FileHeader);
+#if defined(__x86_64__)
+    header.ElfMach = EM_X86_64;
+#elif defined(__aarch64__)
+    header.ElfMach = EM_AARCH64;
+#endif
+    header.Pid = Pid;
+    header.Timestamp = Timestamp();
+
+    if (write(fd, &header, sizeof(header)) != sizeof(header))
+    {
+        close(fd);
+        return;
+    }
+
+    // perf record finds the file through this mapping
+    MarkerSize = sysconf(_SC_PAGESIZE);
+    Marker = mmap(NULL, MarkerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+    if (Marker == MAP_FAILED)
+    {
+        printf("PerfDump: couldn't map %s, perf won't see it\n", path);
+        Marker = NULL;
+    }
+
+    DumpFile = fdopen(fd, "ab");
+}
+
+void DeInit()
+{
+    if (!DumpFile)
+        return;
+
+    RecordHeader close = {record_CodeClose, sizeof(RecordHeader), Timestamp()};
+    fwrite(&close, sizeof(close), 1, DumpFile);
+
+    if (Marker)
+        munmap(Marker, MarkerSize);
+    Marker = NULL;
+
+    fclose(DumpFile);
+    DumpFile = NULL;
+}
+
+void RecordBlock(u32 num, u32 startAddr, const void* code, u32 size)
+{
+    if (!DumpFile)
+        return;
+
+    // the records are timestamped, so blocks which later reuse the
+    // code memory of evicted ones don't get mixed up with them
+    char name[32];
+    int nameLen = snprintf(name, sizeof(name), "ARM%d_%08X", num ? 7 : 9, startAddr) + 1;
+
+    CodeLoadRecord record;
+    record.Header.ID = record_CodeLoad;
+    record.Header.TotalSize = sizeof(CodeLoadRecord) + nameLen + size;
+    record.Header.Timestamp = Timestamp();
+    record.Pid = Pid;
+    record.Tid = syscall(SYS_gettid);
+    record.VMA = (u64)code;
+    record.CodeAddr = (u64)code;
+    record.CodeSize = size;
+    record.CodeIndex = CodeIndex++;
+
+    fwrite(&record, sizeof(record), 1, DumpFile);
+    fwrite(name, nameLen, 1, DumpFile);
+    fwrite(code, size, 1, DumpFile);
+}
+
+}
@@ -0,0 +1,38 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef ARMJIT_PERFDUMP_H
+#define ARMJIT_PERFDUMP_H
+
+#include "types.h"
+
+// writes a jitdump file for Linux perf, so that samples inside
+// the JIT code can be attributed to the guest code they came from
+// record with `perf record -k mono` and run `perf inject --jit` afterwards
+namespace ARMJIT_PerfDump
+{
+
+void Init();
+void DeInit();
+
+// has to be called with the compiler locked
+void RecordBlock(u32 num, u32 startAddr, const void* code, u32 size);
+
+}
+
+#endif
@@ -83,20 +83,19 @@ public:
         abort();
     }
 
-    void PutLiteral(int reg, u32 val)
-    {
-        LiteralsLoaded |= (1 << reg);
-        LiteralValues[reg] = val;
-    }
-
-    void UnloadLiteral(int reg)
+    // the constants are found by PropagateConstants, for the instruction last passed to Prepare
+    bool IsLiteral(int reg)
     {
-        LiteralsLoaded &= ~(1 << reg);
+        return Instrs[CurInstrIdx].KnownRegs & (1 << reg);
     }
 
-    bool IsLiteral(int reg)
+    u32 LiteralValue(int reg)
     {
-        return LiteralsLoaded & (1 << reg);
+        // the last instruction writing the register produced the value
+        int j = CurInstrIdx - 1;
+        while (!(Instrs[j].Info.DstRegs & (1 << reg)))
+            j--;
+        return Instrs[j].ConstResult;
     }
 
     void PrepareExit()
@@ -111,20 +110,16 @@ public:
         BitSet16 loadedSet(LoadedRegs);
         for (int reg : loadedSet)
             UnloadRegister(reg);
-        LiteralsLoaded = 0;
     }
 
     void Prepare(bool thumb, int i)
     {
         FetchedInstr instr = Instrs[i];
+        CurInstrIdx = i;
 
         if (LoadedRegs & (1 << 15))
             UnloadRegister(15);
 
-        BitSet16 invalidedLiterals(LiteralsLoaded & instr.Info.DstRegs);
-        for (int reg : invalidedLiterals)
-            UnloadLiteral(reg);
-
         u16 futureNeeded = 0;
         int ranking[16];
         for (int j = 0; j < 16; j++)
@@ -198,9 +193,7 @@ public:
     static const int NativeRegsAvailable;
 
     Reg Mapping[16];
-    u32 LiteralValues[16];
 
-    u16 LiteralsLoaded = 0;
     u32 NativeRegsUsed = 0;
     u16 LoadedRegs = 0;
     u16 DirtyRegs = 0;
@@ -211,6 +204,7 @@ public:
 
     FetchedInstr* Instrs;
     int InstrsCount;
+    int CurInstrIdx = 0;
 };
 
 }
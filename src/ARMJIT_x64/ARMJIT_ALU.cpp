@@ -18,6 +18,8 @@
 
 #include "ARMJIT_Compiler.h"
 
+#include "../dolphin/CPUDetect.h"
+
 using namespace Gen;
 
 namespace ARMJIT
@@ -36,6 +38,11 @@ void Compiler::Comp_ArithTriOp(void (Compiler::*op)(int, const OpArg&, const OpA
 
     if (rd == rn && !(opFlags & opInvertOp2))
         (this->*op)(32, rd, op2);
+    else if (opFlags & opInvertOp2 && cpu_info.bBMI1 && rd.IsSimpleReg() && op2.IsSimpleReg() && !rn.IsImm())
+    {
+        // BIC
+        ANDN(32, rd.GetSimpleReg(), op2.GetSimpleReg(), rn);
+    }
     else if (opFlags & opSymmetric && op2 == R(RSCRATCH))
     {
         if (opFlags & opInvertOp2)
@@ -246,13 +253,7 @@ void Compiler::A_Comp_MovOp()
         MOV(32, rd, op2);
 
     if (((CurInstr.Instr >> 21) & 0xF) == 0xF)
-    {
         NOT(32, rd);
-        if (op2.IsImm() && CurInstr.Cond() == 0xE)
-            RegCache.PutLiteral(CurInstr.A_Reg(12), ~op2.Imm32());
-    }
-    else if (op2.IsImm() && CurInstr.Cond() == 0xE)
-            RegCache.PutLiteral(CurInstr.A_Reg(12), op2.Imm32());
 
     if (S)
     {
@@ -270,6 +271,12 @@ void Compiler::A_Comp_CLZ()
     OpArg rd = MapReg(CurInstr.A_Reg(12));
     OpArg rm = MapReg(CurInstr.A_Reg(0));
 
+    if (cpu_info.bLZCNT && !rm.IsImm())
+    {
+        LZCNT(32, rd.GetSimpleReg(), rm);
+        return;
+    }
+
     MOV(32, R(RSCRATCH), Imm32(32));
     TEST(32, rm, rm);
     FixupBranch skipZero = J_CC(CC_Z);
@@ -451,11 +458,39 @@ void Compiler::Comp_RetriveFlags(bool sign, bool retriveCV, bool carryUsed)
     }
 }
 
-// always uses RSCRATCH, RSCRATCH2 only if S == true
+// always uses RSCRATCH and RSCRATCH3, RSCRATCH2 only if S == true
 OpArg Compiler::Comp_RegShiftReg(int op, Gen::OpArg rs, Gen::OpArg rm, bool S, bool& carryUsed)
 {
     carryUsed = S;
 
+    if (!S && op < 3 && cpu_info.bBMI2 && !rm.IsImm() && !rs.IsImm())
+    {
+        // BMI2 shifts don't touch the flags and take their shift amount from any register
+        // still amounts of 32 and above need to be taken care of by ourselves
+        static_assert(RSCRATCH3 == ECX, "Someone changed RSCRATCH3");
+        MOVZX(32, 8, ECX, rs);
+        if (op == 2)
+        {
+            MOV(32, R(RSCRATCH), Imm32(31));
+            CMP(32, R(ECX), R(RSCRATCH));
+            CMOVcc(32, ECX, R(RSCRATCH), CC_A);
+            SARX(32, RSCRATCH, rm, ECX);
+        }
+        else
+        {
+            if (op == 0)
+                SHLX(32, RSCRATCH, rm, ECX);
+            else
+                SHRX(32, RSCRATCH, rm, ECX);
+            // all ones if the amount is below 32, zero otherwise
+            CMP(32, R(ECX), Imm8(32));
+            SBB(32, R(ECX), R(ECX));
+            AND(32, R(RSCRATCH), R(ECX));
+        }
+
+        return R(RSCRATCH);
+    }
+
     if (S)
     {
         XOR(32, R(RSCRATCH2), R(RSCRATCH2));
@@ -572,6 +607,12 @@ OpArg Compiler::Comp_RegShiftImm(int op, int amount, OpArg rm, bool S, bool& car
         }
         return R(RSCRATCH);
     case 3: // ROR
+        if (!S && amount > 0 && cpu_info.bBMI2 && !rm.IsImm())
+        {
+            RORX(32, RSCRATCH, rm, amount);
+            return R(RSCRATCH);
+        }
+
         MOV(32, R(RSCRATCH), rm);
         if (amount > 0)
             ROR(32, R(RSCRATCH), Imm8(amount));
@@ -36,9 +36,6 @@ void Compiler::Comp_JumpTo(u32 addr, bool forceNonConstantCycles)
     // we can simplify constant branches by a lot
     IrregularCycles = true;
 
-    u32 newPC;
-    u32 cycles = 0;
-
     if (addr & 0x1 && !Thumb)
     {
         CPSRDirty = true;
@@ -50,96 +47,29 @@ void Compiler::Comp_JumpTo(u32 addr, bool forceNonConstantCycles)
         AND(32, R(RCPSR), Imm32(~0x20));
     }
 
+    // the fetch timing at the target was already looked up
+    // together with the instruction
+    u32 cycles = CurInstr.JumpCycles;
+
     if (Num == 0)
     {
-        ARMv5* cpu9 = (ARMv5*)CurCPU;
-
-        u32 regionCodeCycles = cpu9->MemTimings[addr >> 12][0];
-        u32 compileTimeCodeCycles = cpu9->RegionCodeCycles;
-        cpu9->RegionCodeCycles = regionCodeCycles;
-
         if (Exit)
-            MOV(32, MDisp(RCPU, offsetof(ARMv5, RegionCodeCycles)), Imm32(regionCodeCycles));
-
-        if (addr & 0x1)
-        {
-            addr &= ~0x1;
-            newPC = addr+2;
-
-            // two-opcodes-at-once fetch
-            // doesn't matter if we put garbage in the MSbs there
-            if (addr & 0x2)
-            {
-                cpu9->CodeRead32(addr-2, true);
-                cycles += cpu9->CodeCycles;
-                cpu9->CodeRead32(addr+2, false);
-                cycles += CurCPU->CodeCycles;
-            }
-            else
-            {
-                cpu9->CodeRead32(addr, true);
-                cycles += cpu9->CodeCycles;
-            }
-        }
-        else
-        {
-            addr &= ~0x3;
-            newPC = addr+4;
-
-            cpu9->CodeRead32(addr, true);
-            cycles += cpu9->CodeCycles;
-            cpu9->CodeRead32(addr+4, false);
-            cycles += cpu9->CodeCycles;
-        }
-
-        cpu9->RegionCodeCycles = compileTimeCodeCycles;
+            MOV(32, MDisp(RCPU, offsetof(ARMv5, RegionCodeCycles)), Imm32(CurInstr.JumpRegionCodeCycles));
     }
     else
     {
-        ARMv4* cpu7 = (ARMv4*)CurCPU;
-
         u32 codeRegion = addr >> 24;
         u32 codeCycles = addr >> 15; // cheato
 
-        cpu7->CodeRegion = codeRegion;
-        cpu7->CodeCycles = codeCycles;
-
         if (Exit)
         {
             MOV(32, MDisp(RCPU, offsetof(ARM, CodeRegion)), Imm32(codeRegion));
             MOV(32, MDisp(RCPU, offsetof(ARM, CodeCycles)), Imm32(codeCycles));
         }
-
-        if (addr & 0x1)
-        {
-            addr &= ~0x1;
-            newPC = addr+2;
-
-            // this is necessary because ARM7 bios protection
-            u32 compileTimePC = CurCPU->R[15];
-            CurCPU->R[15] = newPC;
-
-            cycles += NDS::ARM7MemTimings[codeCycles][0] + NDS::ARM7MemTimings[codeCycles][1];
-
-            CurCPU->R[15] = compileTimePC;
-        }
-        else
-        {
-            addr &= ~0x3;
-            newPC = addr+4;
-
-            u32 compileTimePC = CurCPU->R[15];
-            CurCPU->R[15] = newPC;
-
-            cycles += NDS::ARM7MemTimings[codeCycles][2] + NDS::ARM7MemTimings[codeCycles][3];
-
-            CurCPU->R[15] = compileTimePC;
-        }
-
-        cpu7->CodeRegion = R15 >> 24;
-        cpu7->CodeCycles = addr >> 15;
     }
 
+    u32 newPC = addr & 0x1 ? (addr & ~0x1) + 2 : (addr & ~0x3) + 4;
+
     if (Exit)
         MOV(32, MDisp(RCPU, offsetof(ARM, R[15])), Imm32(newPC));
     if ((Thumb || CurInstr.Cond() >= 0xE) && !forceNonConstantCycles)
@@ -237,6 +167,8 @@ void Compiler::T_Comp_B()
 {
     s32 offset = (s32)((CurInstr.Instr & 0x7FF) << 21) >> 20;
     Comp_JumpTo(R15 + offset + 1);
+
+    Comp_SpecialBranchBehaviour(true);
 }
 
 void Compiler::T_Comp_BranchXchangeReg()
@@ -19,6 +19,7 @@
 #include "ARMJIT_Compiler.h"
 
 #include "../ARMInterpreter.h"
+#include "../ARMJIT_PerfDump.h"
 
 #include <assert.h>
 #include <stdarg.h>
@@ -260,7 +261,7 @@ Compiler::Compiler()
         CodeMemSize = alignedSize;
     }
 
-    Reset();
+    SetCodePtr(ResetStart);
 
     {
         // RSCRATCH mode
@@ -470,6 +471,13 @@ Compiler::Compiler()
 
     NearSize = FarStart - ResetStart;
     FarSize = (ResetStart + CodeMemSize) - FarStart;
+
+    NearCode = NearStart;
+    FarCode = FarStart;
+
+    CurCodeSegment = 0;
+    memset(CodeSegmentNearEnd, 0, sizeof(CodeSegmentNearEnd));
+    memset(CodeSegmentFarEnd, 0, sizeof(CodeSegmentFarEnd));
 }
 
 void Compiler::LoadCPSR()
@@ -655,8 +663,24 @@ bool Compiler::CanCompile(bool thumb, u16 kind)
 
 void Compiler::Reset()
 {
-    memset(ResetStart, 0xcc, CodeMemSize);
-    SetCodePtr(ResetStart);
+    // only wipe what was emitted since the last reset
+    // the rest of the code memory was never written to, so it doesn't
+    // have to be committed (that's 32 MB for every process otherwise)
+    CodeSegmentNearEnd[CurCodeSegment] = GetWritableCodePtr();
+    CodeSegmentFarEnd[CurCodeSegment] = FarCode;
+    for (u32 i = 0; i < CodeSegmentCount; i++)
+    {
+        if (!CodeSegmentNearEnd[i])
+            continue;
+
+        memset(NearSegmentStart(i), 0xcc, CodeSegmentNearEnd[i] - NearSegmentStart(i));
+        memset(FarSegmentStart(i), 0xcc, CodeSegmentFarEnd[i] - FarSegmentStart(i));
+        CodeSegmentNearEnd[i] = NULL;
+        CodeSegmentFarEnd[i] = NULL;
+    }
+
+    CurCodeSegment = 0;
+    SetCodePtr(NearStart);
 
     NearCode = NearStart;
     FarCode = FarStart;
@@ -664,6 +688,43 @@ void Compiler::Reset()
     LoadStorePatches.clear();
 }
 
+void Compiler::NextCodeSegment()
+{
+    CodeSegmentNearEnd[CurCodeSegment] = GetWritableCodePtr();
+    CodeSegmentFarEnd[CurCodeSegment] = FarCode;
+
+    CurCodeSegment = (CurCodeSegment + 1) % CodeSegmentCount;
+    u8* nearStart = NearSegmentStart(CurCodeSegment);
+    u8* farStart = FarSegmentStart(CurCodeSegment);
+
+    if (CodeSegmentNearEnd[CurCodeSegment])
+    {
+        // the oldest segment gets reused, so everything in it has to go
+        u8* nearEnd = CodeSegmentNearEnd[CurCodeSegment];
+        u8* farEnd = CodeSegmentFarEnd[CurCodeSegment];
+
+        u32 evicted = EvictBlocks(nearStart, nearEnd);
+        printf("JIT code memory full, evicted %d blocks\n", evicted);
+
+        for (auto it = LoadStorePatches.begin(); it != LoadStorePatches.end();)
+        {
+            if (it->first >= nearStart && it->first < nearEnd)
+                it = LoadStorePatches.erase(it);
+            else
+                it++;
+        }
+
+        memset(nearStart, 0xcc, nearEnd - nearStart);
+        memset(farStart, 0xcc, farEnd - farStart);
+        CodeSegmentNearEnd[CurCodeSegment] = NULL;
+        CodeSegmentFarEnd[CurCodeSegment] = NULL;
+    }
+
+    SetCodePtr(nearStart);
+    NearCode = nearStart;
+    FarCode = farStart;
+}
+
 bool Compiler::IsJITFault(u8* addr)
 {
     return (u64)addr >= (u64)ResetStart && (u64)addr < (u64)ResetStart + CodeMemSize;
@@ -707,29 +768,41 @@ void Compiler::CreateMethod(const char* namefmt, void* start, ...)
 }
 #endif
 
-JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemoryInstr)
+bool Compiler::IsCodeSegmentFull()
 {
-    if (NearSize - (GetCodePtr() - NearStart) < 1024 * 32) // guess...
-    {
-        printf("near reset\n");
-        ResetBlockCache();
-    }
-    if (FarSize - (FarCode - FarStart) < 1024 * 32) // guess...
-    {
-        printf("far reset\n");
-        ResetBlockCache();
-    }
+    return NearSize / CodeSegmentCount - (GetCodePtr() - NearSegmentStart(CurCodeSegment)) < 1024 * 32 // guess...
+        || FarSize / CodeSegmentCount - (FarCode - FarSegmentStart(CurCodeSegment)) < 1024 * 32;
+}
 
+JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemoryInstr, JitBlock* profiledBlock,
+    const ARMJIT_Memory::MapState& mapState)
+{
     ConstantCycles = 0;
     Thumb = thumb;
     Num = cpu->Num;
     CodeRegion = instrs[0].Addr >> 24;
     CurCPU = cpu;
+    MapState = &mapState;
     // CPSR might have been modified in a previous block
     CPSRDirty = false;
 
     JitBlockEntry res = (JitBlockEntry)GetWritableCodePtr();
 
+    if (profiledBlock)
+    {
+        // nothing besides RCPU and RCPSR is live yet
+        // stop counting at zero, the block stays hot until it's recompiled
+        MOV(64, R(RSCRATCH), ImmPtr(&profiledBlock->ExecCounter));
+        CMP(32, MatR(RSCRATCH), Imm8(0));
+        FixupBranch alreadyHot = J_CC(CC_Z);
+        SUB(32, MatR(RSCRATCH), Imm8(1));
+        FixupBranch notHot = J_CC(CC_NZ);
+        MOV(64, R(ABI_PARAM1), ImmPtr(profiledBlock));
+        ABI_CallFunction(MarkBlockHot);
+        SetJumpTarget(notHot);
+        SetJumpTarget(alreadyHot);
+    }
+
     RegCache = RegisterCache<Compiler, X64Reg>(this, instrs, instrsCount);
 
     for (int i = 0; i < instrsCount; i++)
@@ -836,7 +909,15 @@ JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[]
         }
 
         if (comp == NULL)
+        {
+            CMP(32, MDisp(RCPU, offsetof(ARM, LazyFlagsOp)), Imm8(0));
+            FixupBranch flagsDone = J_CC(CC_Z);
+            MOV(64, R(ABI_PARAM1), R(RCPU));
+            ABI_CallFunction(MaterializeFlags);
+            SetJumpTarget(flagsDone);
+
             LoadCPSR();
+        }
     }
 
     RegCache.Flush();
@@ -845,9 +926,14 @@ JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[]
         ADD(32, MDisp(RCPU, offsetof(ARM, Cycles)), Imm32(ConstantCycles));
     JMP((u8*)ARM_Ret, true);
 
+    LastBlockSize = GetWritableCodePtr() - (u8*)res;
+
 #ifdef JIT_PROFILING_ENABLED
     CreateMethod("JIT_Block_%d_%d_%08X", (void*)res, Num, Thumb, instrs[0].Addr);
 #endif
+#ifdef JIT_PERF_DUMP_ENABLED
+    ARMJIT_PerfDump::RecordBlock(Num, instrs[0].Addr, (void*)res, LastBlockSize);
+#endif
 
     /*FILE* codeout = fopen("codeout", "a");
     fprintf(codeout, "beginning block argargarg__ %x!!!", instrs[0].Addr);
@@ -861,7 +947,7 @@ JitBlockEntry Compiler::CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[]
 void Compiler::Comp_AddCycles_C(bool forceNonConstant)
 {
     s32 cycles = Num ?
-        NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 1 : 3]
+        CurInstr.SeqCodeCycles
         : ((R15 & 0x2) ? 0 : CurInstr.CodeCycles);
 
     if ((!Thumb && CurInstr.Cond() < 0xE) || forceNonConstant)
@@ -873,7 +959,7 @@ void Compiler::Comp_AddCycles_C(bool forceNonConstant)
 void Compiler::Comp_AddCycles_CI(u32 i)
 {
     s32 cycles = (Num ?
-        NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2]
+        CurInstr.NonseqCodeCycles
         : ((R15 & 0x2) ? 0 : CurInstr.CodeCycles)) + i;
 
     if (!Thumb && CurInstr.Cond() < 0xE)
@@ -885,7 +971,7 @@ void Compiler::Comp_AddCycles_CI(u32 i)
 void Compiler::Comp_AddCycles_CI(Gen::X64Reg i, int add)
 {
     s32 cycles = Num ?
-        NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2]
+        CurInstr.NonseqCodeCycles
         : ((R15 & 0x2) ? 0 : CurInstr.CodeCycles);
 
     if (!Thumb && CurInstr.Cond() < 0xE)
@@ -910,7 +996,7 @@ void Compiler::Comp_AddCycles_CDI()
 
         s32 cycles;
 
-        s32 numC = NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2];
+        s32 numC = CurInstr.NonseqCodeCycles;
         s32 numD = CurInstr.DataCycles;
 
         if ((CurInstr.DataRegion >> 24) == 0x02) // mainRAM
@@ -955,7 +1041,7 @@ void Compiler::Comp_AddCycles_CD()
     }
     else
     {
-        s32 numC = NDS::ARM7MemTimings[CurInstr.CodeCycles][Thumb ? 0 : 2];
+        s32 numC = CurInstr.NonseqCodeCycles;
         s32 numD = CurInstr.DataCycles;
 
         if ((CurInstr.DataRegion >> 4) == 0x02)
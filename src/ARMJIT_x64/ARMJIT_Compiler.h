@@ -23,6 +23,7 @@
 
 #include "../ARMJIT.h"
 #include "../ARMJIT_Internal.h"
+#include "../ARMJIT_Memory.h"
 #include "../ARMJIT_RegisterCache.h"
 
 #ifdef JIT_PROFILING_ENABLED
@@ -83,7 +84,15 @@ public:
 
     void Reset();
 
-    JitBlockEntry CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemoryInstr);
+    // has to be checked before compiling a block, moving on to the next
+    // segment evicts all the blocks in it
+    bool IsCodeSegmentFull();
+    // profiledBlock is the block whose executions are counted, NULL if none
+    // mapState is the memory map as it was when the block was fetched
+    JitBlockEntry CompileBlock(ARM* cpu, bool thumb, FetchedInstr instrs[], int instrsCount, bool hasMemoryInstr, JitBlock* profiledBlock,
+        const ARMJIT_Memory::MapState& mapState);
+    // size of the code emitted by the last call to CompileBlock
+    u32 LastBlockSize;
 
     void LoadReg(int reg, Gen::X64Reg nativeReg);
     void SaveReg(int reg, Gen::X64Reg nativeReg);
@@ -168,7 +177,7 @@ public:
     };
     void Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flags);
     s32 Comp_MemAccessBlock(int rn, BitSet16 regs, bool store, bool preinc, bool decrement, bool usermode, bool skipLoadingRn);
-    bool Comp_MemLoadLiteral(int size, bool signExtend, int rd, u32 addr);
+    bool Comp_MemLoadLiteral(int rd);
 
     void Comp_ArithTriOp(void (Compiler::*op)(int, const Gen::OpArg&, const Gen::OpArg&),
         Gen::OpArg rd, Gen::OpArg rn, Gen::OpArg op2, bool carryUsed, int opFlags);
@@ -246,6 +255,20 @@ public:
     u8* NearStart;
     u8* FarStart;
 
+    // near and far code memory are both split into segments, which are
+    // filled one after another. once all are used the oldest one is evicted
+    static const u32 CodeSegmentCount = 8;
+    u32 CurCodeSegment;
+    u8* CodeSegmentNearEnd[CodeSegmentCount];
+    u8* CodeSegmentFarEnd[CodeSegmentCount];
+
+    u8* NearSegmentStart(u32 segment)
+    { return NearStart + segment * (NearSize / CodeSegmentCount); }
+    u8* FarSegmentStart(u32 segment)
+    { return FarStart + segment * (FarSize / CodeSegmentCount); }
+
+    void NextCodeSegment();
+
     void* PatchedStoreFuncs[2][2][3][16];
     void* PatchedLoadFuncs[2][2][3][2][16];
 
@@ -274,6 +297,7 @@ public:
     u32 ConstantCycles;
 
     ARM* CurCPU;
+    const ARMJIT_Memory::MapState* MapState;
 };
 
 }
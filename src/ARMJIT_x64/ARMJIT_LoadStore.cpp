@@ -65,45 +65,16 @@ u8* Compiler::RewriteMemAccess(u8* pc)
     improvement.
 */
 
-bool Compiler::Comp_MemLoadLiteral(int size, bool signExtend, int rd, u32 addr)
+bool Compiler::Comp_MemLoadLiteral(int rd)
 {
-    u32 localAddr = LocaliseCodeAddress(Num, addr);
-
-    int invalidLiteralIdx = InvalidLiterals.Find(localAddr);
-    if (invalidLiteralIdx != -1)
+    if (!CurInstr.HasLiteral)
     {
         return false;
     }
 
     Comp_AddCycles_CDI();
 
-    u32 val;
-    // make sure arm7 bios is accessible
-    u32 tmpR15 = CurCPU->R[15];
-    CurCPU->R[15] = R15;
-    if (size == 32)
-    {
-        CurCPU->DataRead32(addr & ~0x3, &val);
-        val = ::ROR(val, (addr & 0x3) << 3);
-    }
-    else if (size == 16)
-    {
-        CurCPU->DataRead16(addr & ~0x1, &val);
-        if (signExtend)
-            val = ((s32)val << 16) >> 16;
-    }
-    else
-    {
-        CurCPU->DataRead8(addr, &val);
-        if (signExtend)
-            val = ((s32)val << 24) >> 24;
-    }
-    CurCPU->R[15] = tmpR15;
-
-    MOV(32, MapReg(rd), Imm32(val));
-
-    if (Thumb || CurInstr.Cond() == 0xE)
-        RegCache.PutLiteral(rd, val);
+    MOV(32, MapReg(rd), Imm32(CurInstr.LiteralValue));
 
     return true;
 }
@@ -119,9 +90,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
 
     if (LiteralOptimizations && rn == 15 && rd != 15 && op2.IsImm && !(flags & (memop_Post|memop_Store|memop_Writeback)))
     {
-        u32 addr = R15 + op2.Imm * ((flags & memop_SubtractOffset) ? -1 : 1);
-
-        if (Comp_MemLoadLiteral(size, flags & memop_SignExtend, rd, addr))
+        if (Comp_MemLoadLiteral(rd))
             return;
     }
 
@@ -138,7 +107,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
         && RegCache.IsLiteral(rn) && op2.IsImm && !(flags & (memop_Writeback|memop_Post));
     u32 staticAddress;
     if (addrIsStatic)
-        staticAddress = RegCache.LiteralValues[rn] + op2.Imm * ((flags & memop_SubtractOffset) ? -1 : 1);
+        staticAddress = RegCache.LiteralValue(rn) + op2.Imm * ((flags & memop_SubtractOffset) ? -1 : 1);
     OpArg rdMapped = MapReg(rd);
 
     OpArg rnMapped = MapReg(rn);
@@ -195,10 +164,27 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
         MOV(32, rnMapped, R(finalAddr));
 
     u32 expectedTarget = Num == 0
-        ? ARMJIT_Memory::ClassifyAddress9(CurInstr.DataRegion)
-        : ARMJIT_Memory::ClassifyAddress7(CurInstr.DataRegion);
+        ? ARMJIT_Memory::ClassifyAddress9(*MapState, CurInstr.DataRegion)
+        : ARMJIT_Memory::ClassifyAddress7(*MapState, CurInstr.DataRegion);
+
+    void* ioVar = NULL;
+    int ioVarSize;
+    if (addrIsStatic && !(flags & memop_Store))
+        ioVar = ARMJIT_Memory::GetInlinableIORead(*MapState, CurCPU, staticAddress, size, ioVarSize);
 
-    if (ARMJIT::FastMemory && ((!Thumb && CurInstr.Cond() != 0xE) || ARMJIT_Memory::IsFastmemCompatible(expectedTarget)))
+    if (ioVar)
+    {
+        MOV(64, R(RSCRATCH), ImmPtr(ioVar));
+
+        int bits = std::min(size, ioVarSize);
+        if (bits == 32)
+            MOV(32, rdMapped, MatR(RSCRATCH));
+        else if (flags & memop_SignExtend)
+            MOVSX(32, bits, rdMapped.GetSimpleReg(), MatR(RSCRATCH));
+        else
+            MOVZX(32, bits, rdMapped.GetSimpleReg(), MatR(RSCRATCH));
+    }
+    else if (ARMJIT::FastMemory && ((!Thumb && CurInstr.Cond() != 0xE) || ARMJIT_Memory::IsFastmemCompatible(expectedTarget)))
     {
         if (rdMapped.IsImm())
         {
@@ -211,8 +197,8 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
 
         assert(rdMapped.GetSimpleReg() >= 0 && rdMapped.GetSimpleReg() < 16);
         patch.PatchFunc = flags & memop_Store
-            ? PatchedStoreFuncs[NDS::ConsoleType][Num][__builtin_ctz(size) - 3][rdMapped.GetSimpleReg()]
-            : PatchedLoadFuncs[NDS::ConsoleType][Num][__builtin_ctz(size) - 3][!!(flags & memop_SignExtend)][rdMapped.GetSimpleReg()];
+            ? PatchedStoreFuncs[MapState->ConsoleType][Num][__builtin_ctz(size) - 3][rdMapped.GetSimpleReg()]
+            : PatchedLoadFuncs[MapState->ConsoleType][Num][__builtin_ctz(size) - 3][!!(flags & memop_SignExtend)][rdMapped.GetSimpleReg()];
 
         assert(patch.PatchFunc != NULL);
 
@@ -267,7 +253,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
 
         void* func = NULL;
         if (addrIsStatic)
-            func = ARMJIT_Memory::GetFuncForAddr(CurCPU, staticAddress, flags & memop_Store, size);
+            func = ARMJIT_Memory::GetFuncForAddr(*MapState, CurCPU, staticAddress, flags & memop_Store, size);
 
         if (func)
         {
@@ -312,7 +298,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
                     MOV(32, R(ABI_PARAM1), R(RSCRATCH3));
                 if (flags & memop_Store)
                 {
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: CALL((void*)&SlowWrite9<u32, 0>); break;
                     case 16: CALL((void*)&SlowWrite9<u16, 0>); break;
@@ -324,7 +310,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
                 }
                 else
                 {
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: CALL((void*)&SlowRead9<u32, 0>); break;
                     case 16: CALL((void*)&SlowRead9<u16, 0>); break;
@@ -343,7 +329,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
                 {
                     MOV(32, R(ABI_PARAM2), rdMapped);
 
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: CALL((void*)&SlowWrite7<u32, 0>); break;
                     case 16: CALL((void*)&SlowWrite7<u16, 0>); break;
@@ -355,7 +341,7 @@ void Compiler::Comp_MemAccess(int rd, int rn, const Op2& op2, int size, int flag
                 }
                 else
                 {
-                    switch (size | NDS::ConsoleType)
+                    switch (size | MapState->ConsoleType)
                     {
                     case 32: CALL((void*)&SlowRead7<u32, 0>); break;
                     case 16: CALL((void*)&SlowRead7<u16, 0>); break;
@@ -421,8 +407,8 @@ s32 Compiler::Comp_MemAccessBlock(int rn, BitSet16 regs, bool store, bool preinc
     s32 offset = (regsCount * 4) * (decrement ? -1 : 1);
 
     int expectedTarget = Num == 0
-        ? ARMJIT_Memory::ClassifyAddress9(CurInstr.DataRegion)
-        : ARMJIT_Memory::ClassifyAddress7(CurInstr.DataRegion);
+        ? ARMJIT_Memory::ClassifyAddress9(*MapState, CurInstr.DataRegion)
+        : ARMJIT_Memory::ClassifyAddress7(*MapState, CurInstr.DataRegion);
 
     if (!store)
         Comp_AddCycles_CDI();
@@ -522,7 +508,7 @@ s32 Compiler::Comp_MemAccessBlock(int rn, BitSet16 regs, bool store, bool preinc
         if (Num == 0)
             MOV(64, R(ABI_PARAM4), R(RCPU));
 
-        switch (Num * 2 | NDS::ConsoleType)
+        switch (Num * 2 | MapState->ConsoleType)
         {
         case 0: CALL((void*)&SlowBlockTransfer9<false, 0>); break;
         case 1: CALL((void*)&SlowBlockTransfer9<false, 1>); break;
@@ -626,7 +612,7 @@ s32 Compiler::Comp_MemAccessBlock(int rn, BitSet16 regs, bool store, bool preinc
         if (Num == 0)
             MOV(64, R(ABI_PARAM4), R(RCPU));
 
-        switch (Num * 2 | NDS::ConsoleType)
+        switch (Num * 2 | MapState->ConsoleType)
         {
         case 0: CALL((void*)&SlowBlockTransfer9<true, 0>); break;
         case 1: CALL((void*)&SlowBlockTransfer9<true, 1>); break;
@@ -806,8 +792,7 @@ void Compiler::T_Comp_MemImmHalf()
 void Compiler::T_Comp_LoadPCRel()
 {
     u32 offset = (CurInstr.Instr & 0xFF) << 2;
-    u32 addr = (R15 & ~0x2) + offset;
-    if (!LiteralOptimizations || !Comp_MemLoadLiteral(32, false, CurInstr.T_Reg(8), addr))
+    if (!LiteralOptimizations || !Comp_MemLoadLiteral(CurInstr.T_Reg(8)))
         Comp_MemAccess(CurInstr.T_Reg(8), 15, Op2(offset), 32, 0);
 }
 
@@ -20,7 +20,9 @@
 
 #include <stdio.h>
 
+#ifdef JIT_ENABLED
 #include "ARMJIT.h"
+#endif
 
 namespace ARMInstrInfo
 {
@@ -386,7 +388,9 @@ Info Decode(bool thumb, u32 num, u32 instr)
         {
             if (res.Kind == tk_LDR_PCREL)
             {
+#ifdef JIT_ENABLED
                 if (!ARMJIT::LiteralOptimizations)
+#endif
                     res.SrcRegs |= 1 << 15;
                 res.SpecialKind = special_LoadLiteral;
             }
@@ -562,4 +566,50 @@ Info Decode(bool thumb, u32 num, u32 instr)
     }
 }
 
+bool IsIdleLoop(bool thumb, u32 loopAddr, const u32* instrs, const Info* infos, int count)
+{
+    // see https://github.com/dolphin-emu/dolphin/blob/master/Source/Core/Core/PowerPC/PPCAnalyst.cpp#L678
+    // it basically checks if one iteration of a loop depends on another
+    // the rules are quite simple
+
+    u32 instrSize = thumb ? 2 : 4;
+    u32 loopEnd = loopAddr + (count - 1) * instrSize;
+
+    u16 regsWrittenTo = 0;
+    u16 regsDisallowedToWrite = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (infos[i].SpecialKind == special_WriteMem)
+            return false;
+        if (!thumb && infos[i].Kind >= ak_MSR_IMM && infos[i].Kind <= ak_MRC)
+            return false;
+        if (i < count - 1 && infos[i].Branches())
+        {
+            // polling loops often test their condition at the top
+            // and jump out of the loop, that doesn't hurt either
+            u32 addr = loopAddr + i * instrSize;
+            u32 target;
+            if (thumb && infos[i].Kind == tk_BCOND)
+                target = addr + 4 + ((s32)(s8)(instrs[i] & 0xFF) << 1);
+            else if (!thumb && infos[i].Kind == ak_B && (instrs[i] >> 28) < 0xE)
+                target = addr + 8 + ((s32)(instrs[i] << 8) >> 6);
+            else
+                return false;
+
+            if (target >= loopAddr && target <= loopEnd)
+                return false;
+        }
+
+        u16 srcRegs = infos[i].SrcRegs & ~(1 << 15);
+        u16 dstRegs = infos[i].DstRegs & ~(1 << 15);
+
+        regsDisallowedToWrite |= srcRegs & ~regsWrittenTo;
+
+        if (dstRegs & regsDisallowedToWrite)
+            return false;
+        regsWrittenTo |= dstRegs;
+    }
+    return true;
+}
+
 }
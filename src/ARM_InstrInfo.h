@@ -276,6 +276,12 @@ struct Info
 
 Info Decode(bool thumb, u32 num, u32 instr);
 
+// whether a loop, closed by a backwards branch as its last instruction, can't
+// make any progress on its own. Such a loop only reads from memory and
+// no iteration depends on the results of a previous one, so it can only be
+// left once something else changes the memory it polls or an IRQ arrives.
+bool IsIdleLoop(bool thumb, u32 loopAddr, const u32* instrs, const Info* infos, int count);
+
 }
 
 #endif
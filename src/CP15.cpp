@@ -73,6 +73,10 @@ void ARMv5::CP15DoSavestate(Savestate* file)
 {
     file->Section("CP15");
 
+    // rebuilding the PU maps is costly, skip it if the state didn't change them
+    u32 oldpu[7+8] = {NDS::ARM9ClockShift, CP15Control, PU_CodeCacheable, PU_DataCacheable, PU_DataCacheWrite, PU_CodeRW, PU_DataRW};
+    memcpy(&oldpu[7], PU_Region, 8*sizeof(u32));
+
     file->Var32(&CP15Control);
 
     file->Var32(&DTCMSetting);
@@ -94,7 +98,11 @@ void ARMv5::CP15DoSavestate(Savestate* file)
     {
         UpdateDTCMSetting();
         UpdateITCMSetting();
-        UpdatePURegions(true);
+
+        u32 newpu[7+8] = {NDS::ARM9ClockShift, CP15Control, PU_CodeCacheable, PU_DataCacheable, PU_DataCacheWrite, PU_CodeRW, PU_DataRW};
+        memcpy(&newpu[7], PU_Region, 8*sizeof(u32));
+        if (memcmp(oldpu, newpu, sizeof(oldpu)))
+            UpdatePURegions(true);
     }
 }
 
@@ -238,8 +246,6 @@ void ARMv5::UpdatePURegion(u32 n)
         PU_UserMap[i] = usermask;
         PU_PrivMap[i] = privmask;
     }
-
-    UpdateRegionTimings(start, end);
 }
 
 void ARMv5::UpdatePURegions(bool update_all)
@@ -255,7 +261,7 @@ void ARMv5::UpdatePURegions(bool update_all)
         memset(PU_UserMap, mask, 0x100000);
         memset(PU_PrivMap, mask, 0x100000);
 
-        UpdateRegionTimings(0x00000, 0x100000);
+        UpdateRegionTimings();
         return;
     }
 
@@ -272,38 +278,42 @@ void ARMv5::UpdatePURegions(bool update_all)
 
     // TODO: this is way unoptimized
     // should be okay unless the game keeps changing shit, tho
-    if (update_all) UpdateRegionTimings(0x00000, 0x100000);
+    if (update_all) UpdateRegionTimings();
 
     // TODO: throw exception if the region we're running in has become non-executable, I guess
 }
 
-void ARMv5::UpdateRegionTimings(u32 addrstart, u32 addrend)
+void ARMv5::UpdateRegionTimings()
 {
-    for (u32 i = addrstart; i < addrend; i++)
+    for (u32 region = 0; region < 32; region++)
     {
-        u8 pu = PU_Map[i];
-        u8* bustimings = NDS::ARM9MemTimings[i >> 2];
+        u8* bustimings = NDS::ARM9RegionTimings[region];
 
-        if (pu & 0x40)
+        for (u32 cache = 0; cache < 8; cache++)
         {
-            MemTimings[i][0] = 0xFF;//kCodeCacheTiming;
-        }
-        else
-        {
-            MemTimings[i][0] = bustimings[2] << NDS::ARM9ClockShift;
-        }
+            u8* timings = MemTimingTable[region][cache];
 
-        if (pu & 0x10)
-        {
-            MemTimings[i][1] = kDataCacheTiming;
-            MemTimings[i][2] = kDataCacheTiming;
-            MemTimings[i][3] = 1;
-        }
-        else
-        {
-            MemTimings[i][1] = bustimings[0] << NDS::ARM9ClockShift;
-            MemTimings[i][2] = bustimings[2] << NDS::ARM9ClockShift;
-            MemTimings[i][3] = bustimings[3] << NDS::ARM9ClockShift;
+            if (cache & 0x4)
+            {
+                timings[0] = 0xFF;//kCodeCacheTiming;
+            }
+            else
+            {
+                timings[0] = bustimings[2] << NDS::ARM9ClockShift;
+            }
+
+            if (cache & 0x1)
+            {
+                timings[1] = kDataCacheTiming;
+                timings[2] = kDataCacheTiming;
+                timings[3] = 1;
+            }
+            else
+            {
+                timings[1] = bustimings[0] << NDS::ARM9ClockShift;
+                timings[2] = bustimings[2] << NDS::ARM9ClockShift;
+                timings[3] = bustimings[3] << NDS::ARM9ClockShift;
+            }
         }
     }
 }
@@ -381,8 +391,8 @@ void ARMv5::ICacheLookup(u32 addr)
     ICacheTags[line] = tag;
 
     // ouch :/
-    //printf("cache miss %08X: %d/%d\n", addr, NDS::ARM9MemTimings[addr >> 14][2], NDS::ARM9MemTimings[addr >> 14][3]);
-    CodeCycles = (NDS::ARM9MemTimings[addr >> 14][2] + (NDS::ARM9MemTimings[addr >> 14][3] * 7)) << NDS::ARM9ClockShift;
+    //printf("cache miss %08X: %d/%d\n", addr, NDS::ARM9MemTimings(addr >> 14)[2], NDS::ARM9MemTimings(addr >> 14)[3]);
+    CodeCycles = (NDS::ARM9MemTimings(addr >> 14)[2] + (NDS::ARM9MemTimings(addr >> 14)[3] * 7)) << NDS::ARM9ClockShift;
     CurICacheLine = ptr;
 }
 
@@ -804,7 +814,7 @@ void ARMv5::DataRead8(u32 addr, u32* val)
     }
 
     *val = BusRead8(addr);
-    DataCycles = MemTimings[addr >> 12][1];
+    DataCycles = MemTimings(addr)[1];
 }
 
 void ARMv5::DataRead16(u32 addr, u32* val)
@@ -833,7 +843,7 @@ void ARMv5::DataRead16(u32 addr, u32* val)
     }
 
     *val = BusRead16(addr);
-    DataCycles = MemTimings[addr >> 12][1];
+    DataCycles = MemTimings(addr)[1];
 }
 
 void ARMv5::DataRead32(u32 addr, u32* val)
@@ -862,7 +872,7 @@ void ARMv5::DataRead32(u32 addr, u32* val)
     }
 
     *val = BusRead32(addr);
-    DataCycles = MemTimings[addr >> 12][2];
+    DataCycles = MemTimings(addr)[2];
 }
 
 void ARMv5::DataRead32S(u32 addr, u32* val)
@@ -883,7 +893,7 @@ void ARMv5::DataRead32S(u32 addr, u32* val)
     }
 
     *val = BusRead32(addr);
-    DataCycles += MemTimings[addr >> 12][3];
+    DataCycles += MemTimings(addr)[3];
 }
 
 void ARMv5::DataWrite8(u32 addr, u8 val)
@@ -913,7 +923,7 @@ void ARMv5::DataWrite8(u32 addr, u8 val)
     }
 
     BusWrite8(addr, val);
-    DataCycles = MemTimings[addr >> 12][1];
+    DataCycles = MemTimings(addr)[1];
 }
 
 void ARMv5::DataWrite16(u32 addr, u16 val)
@@ -945,7 +955,7 @@ void ARMv5::DataWrite16(u32 addr, u16 val)
     }
 
     BusWrite16(addr, val);
-    DataCycles = MemTimings[addr >> 12][1];
+    DataCycles = MemTimings(addr)[1];
 }
 
 void ARMv5::DataWrite32(u32 addr, u32 val)
@@ -977,7 +987,7 @@ void ARMv5::DataWrite32(u32 addr, u32 val)
     }
 
     BusWrite32(addr, val);
-    DataCycles = MemTimings[addr >> 12][2];
+    DataCycles = MemTimings(addr)[2];
 }
 
 void ARMv5::DataWrite32S(u32 addr, u32 val)
@@ -1001,7 +1011,7 @@ void ARMv5::DataWrite32S(u32 addr, u32 val)
     }
 
     BusWrite32(addr, val);
-    DataCycles += MemTimings[addr >> 12][3];
+    DataCycles += MemTimings(addr)[3];
 }
 
 void ARMv5::GetCodeMemRegion(u32 addr, NDS::MemRegion* region)
@@ -194,14 +194,14 @@ u32 DMA::UnitTimings9_16(bool burststart)
     u32 src_id = CurSrcAddr >> 14;
     u32 dst_id = CurDstAddr >> 14;
 
-    u32 src_rgn = NDS::ARM9Regions[src_id];
-    u32 dst_rgn = NDS::ARM9Regions[dst_id];
+    u32 src_rgn = NDS::ARM9Region(src_id);
+    u32 dst_rgn = NDS::ARM9Region(dst_id);
 
     u32 src_n, src_s, dst_n, dst_s;
-    src_n = NDS::ARM9MemTimings[src_id][4];
-    src_s = NDS::ARM9MemTimings[src_id][5];
-    dst_n = NDS::ARM9MemTimings[dst_id][4];
-    dst_s = NDS::ARM9MemTimings[dst_id][5];
+    src_n = NDS::ARM9MemTimings(src_id)[4];
+    src_s = NDS::ARM9MemTimings(src_id)[5];
+    dst_n = NDS::ARM9MemTimings(dst_id)[4];
+    dst_s = NDS::ARM9MemTimings(dst_id)[5];
 
     if (src_rgn == NDS::Mem9_MainRAM)
     {
@@ -280,14 +280,14 @@ u32 DMA::UnitTimings9_32(bool burststart)
     u32 src_id = CurSrcAddr >> 14;
     u32 dst_id = CurDstAddr >> 14;
 
-    u32 src_rgn = NDS::ARM9Regions[src_id];
-    u32 dst_rgn = NDS::ARM9Regions[dst_id];
+    u32 src_rgn = NDS::ARM9Region(src_id);
+    u32 dst_rgn = NDS::ARM9Region(dst_id);
 
     u32 src_n, src_s, dst_n, dst_s;
-    src_n = NDS::ARM9MemTimings[src_id][6];
-    src_s = NDS::ARM9MemTimings[src_id][7];
-    dst_n = NDS::ARM9MemTimings[dst_id][6];
-    dst_s = NDS::ARM9MemTimings[dst_id][7];
+    src_n = NDS::ARM9MemTimings(src_id)[6];
+    src_s = NDS::ARM9MemTimings(src_id)[7];
+    dst_n = NDS::ARM9MemTimings(dst_id)[6];
+    dst_s = NDS::ARM9MemTimings(dst_id)[7];
 
     if (src_rgn == NDS::Mem9_MainRAM)
     {
@@ -372,14 +372,14 @@ u32 DMA::UnitTimings7_16(bool burststart)
     u32 src_id = CurSrcAddr >> 15;
     u32 dst_id = CurDstAddr >> 15;
 
-    u32 src_rgn = NDS::ARM7Regions[src_id];
-    u32 dst_rgn = NDS::ARM7Regions[dst_id];
+    u32 src_rgn = NDS::ARM7Region(src_id);
+    u32 dst_rgn = NDS::ARM7Region(dst_id);
 
     u32 src_n, src_s, dst_n, dst_s;
-    src_n = NDS::ARM7MemTimings[src_id][0];
-    src_s = NDS::ARM7MemTimings[src_id][1];
-    dst_n = NDS::ARM7MemTimings[dst_id][0];
-    dst_s = NDS::ARM7MemTimings[dst_id][1];
+    src_n = NDS::ARM7MemTimings(src_id)[0];
+    src_s = NDS::ARM7MemTimings(src_id)[1];
+    dst_n = NDS::ARM7MemTimings(dst_id)[0];
+    dst_s = NDS::ARM7MemTimings(dst_id)[1];
 
     if (src_rgn == NDS::Mem7_MainRAM)
     {
@@ -458,14 +458,14 @@ u32 DMA::UnitTimings7_32(bool burststart)
     u32 src_id = CurSrcAddr >> 15;
     u32 dst_id = CurDstAddr >> 15;
 
-    u32 src_rgn = NDS::ARM7Regions[src_id];
-    u32 dst_rgn = NDS::ARM7Regions[dst_id];
+    u32 src_rgn = NDS::ARM7Region(src_id);
+    u32 dst_rgn = NDS::ARM7Region(dst_id);
 
     u32 src_n, src_s, dst_n, dst_s;
-    src_n = NDS::ARM7MemTimings[src_id][2];
-    src_s = NDS::ARM7MemTimings[src_id][3];
-    dst_n = NDS::ARM7MemTimings[dst_id][2];
-    dst_s = NDS::ARM7MemTimings[dst_id][3];
+    src_n = NDS::ARM7MemTimings(src_id)[2];
+    src_s = NDS::ARM7MemTimings(src_id)[3];
+    dst_n = NDS::ARM7MemTimings(dst_id)[2];
+    dst_s = NDS::ARM7MemTimings(dst_id)[3];
 
     if (src_rgn == NDS::Mem7_MainRAM)
     {
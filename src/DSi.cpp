@@ -1209,6 +1209,8 @@ void ApplyNewRAMSize(u32 size)
         printf("RAM: 16MB\n");
         break;
     }
+
+    NDS::UpdateReadPages(0x02000000, 0x03000000);
 }
 
 
@@ -1225,7 +1227,7 @@ void Set_SCFG_Clock9(u16 val)
 
     NDS::ARM9Timestamp <<= NDS::ARM9ClockShift;
     NDS::ARM9Target    <<= NDS::ARM9ClockShift;
-    NDS::ARM9->UpdateRegionTimings(0x00000, 0x100000);
+    NDS::ARM9->UpdateRegionTimings();
 }
 
 void Set_SCFG_MC(u32 val)
@@ -18,13 +18,10 @@
 
 #ifndef __MINGW32__
 #include <stdio.h>
-<<<<<<< HEAD
 #else
 #include <wchar.h>
 #endif
-=======
 #include <codecvt>
->>>>>>> 20c39eb3f148f09e547a07eb7f9cd65840b6f989
 
 #include "DSi.h"
 #include "DSi_AES.h"
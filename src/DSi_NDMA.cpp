@@ -200,11 +200,11 @@ void DSi_NDMA::Run9()
 
     if ((CurSrcAddr >> 24) == 0x02 && (CurDstAddr >> 24) == 0x02)
     {
-        unitcycles = NDS::ARM9MemTimings[CurSrcAddr >> 14][2] + NDS::ARM9MemTimings[CurDstAddr >> 14][2];
+        unitcycles = NDS::ARM9MemTimings(CurSrcAddr >> 14)[2] + NDS::ARM9MemTimings(CurDstAddr >> 14)[2];
     }
     else
     {
-        unitcycles = NDS::ARM9MemTimings[CurSrcAddr >> 14][3] + NDS::ARM9MemTimings[CurDstAddr >> 14][3];
+        unitcycles = NDS::ARM9MemTimings(CurSrcAddr >> 14)[3] + NDS::ARM9MemTimings(CurDstAddr >> 14)[3];
         if ((CurSrcAddr >> 24) == (CurDstAddr >> 24))
             unitcycles++;
         else if ((CurSrcAddr >> 24) == 0x02)
@@ -213,7 +213,7 @@ void DSi_NDMA::Run9()
         /*if (burststart)
         {
             cycles -= 2;
-            cycles -= (NDS::ARM9MemTimings[CurSrcAddr >> 14][2] + NDS::ARM9MemTimings[CurDstAddr >> 14][2]);
+            cycles -= (NDS::ARM9MemTimings(CurSrcAddr >> 14)[2] + NDS::ARM9MemTimings(CurDstAddr >> 14)[2]);
             cycles += unitcycles;
         }*/
     }
@@ -289,11 +289,11 @@ void DSi_NDMA::Run7()
 
     if ((CurSrcAddr >> 24) == 0x02 && (CurDstAddr >> 24) == 0x02)
     {
-        unitcycles = NDS::ARM7MemTimings[CurSrcAddr >> 15][2] + NDS::ARM7MemTimings[CurDstAddr >> 15][2];
+        unitcycles = NDS::ARM7MemTimings(CurSrcAddr >> 15)[2] + NDS::ARM7MemTimings(CurDstAddr >> 15)[2];
     }
     else
     {
-        unitcycles = NDS::ARM7MemTimings[CurSrcAddr >> 15][3] + NDS::ARM7MemTimings[CurDstAddr >> 15][3];
+        unitcycles = NDS::ARM7MemTimings(CurSrcAddr >> 15)[3] + NDS::ARM7MemTimings(CurDstAddr >> 15)[3];
         if ((CurSrcAddr >> 23) == (CurDstAddr >> 23))
             unitcycles++;
         else if ((CurSrcAddr >> 24) == 0x02)
@@ -302,7 +302,7 @@ void DSi_NDMA::Run7()
         /*if (burststart)
         {
             cycles -= 2;
-            cycles -= (NDS::ARM7MemTimings[CurSrcAddr >> 15][2] + NDS::ARM7MemTimings[CurDstAddr >> 15][2]);
+            cycles -= (NDS::ARM7MemTimings(CurSrcAddr >> 15)[2] + NDS::ARM7MemTimings(CurDstAddr >> 15)[2]);
             cycles += unitcycles;
         }*/
     }
@@ -35,6 +35,7 @@ u32 NextVCount;
 u16 TotalScanlines;
 
 bool RunFIFO;
+bool SkipRender2D;
 
 u16 DispStat[2], VMatch[2];
 
@@ -122,6 +123,7 @@ VRAMTrackingSet<512*1024, 128*1024> VRAMDirty_Texture;
 VRAMTrackingSet<128*1024, 16*1024> VRAMDirty_TexPal;
 
 NonStupidBitField<128*1024/VRAMDirtyGranularity> VRAMDirty[9];
+NonStupidBitField<128*1024/VRAMDirtyGranularity> VRAMStateDirty[9];
 
 u8 VRAMFlat_ABG[512*1024];
 u8 VRAMFlat_BBG[128*1024];
@@ -197,6 +199,8 @@ void ResetVRAMCache()
 
 void Reset()
 {
+    SkipRender2D = false;
+
     VCount = 0;
     NextVCount = -1;
     TotalScanlines = 0;
@@ -218,6 +222,8 @@ void Reset()
     memset(VRAM_G, 0,  16*1024);
     memset(VRAM_H, 0,  32*1024);
     memset(VRAM_I, 0,  16*1024);
+    for (int i = 0; i < 9; i++)
+        VRAMStateDirty[i].SetRange(0, 128*1024/VRAMDirtyGranularity);
 
     memset(VRAMCNT, 0, 9);
     VRAMSTAT = 0;
@@ -314,15 +320,15 @@ void DoSavestate(Savestate* file)
     file->VarArray(Palette, 2*1024);
     file->VarArray(OAM, 2*1024);
 
-    file->VarArray(VRAM_A, 128*1024);
-    file->VarArray(VRAM_B, 128*1024);
-    file->VarArray(VRAM_C, 128*1024);
-    file->VarArray(VRAM_D, 128*1024);
-    file->VarArray(VRAM_E,  64*1024);
-    file->VarArray(VRAM_F,  16*1024);
-    file->VarArray(VRAM_G,  16*1024);
-    file->VarArray(VRAM_H,  32*1024);
-    file->VarArray(VRAM_I,  16*1024);
+    file->VarArrayDirty(VRAM_A, 128*1024, VRAMStateDirty[0], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_B, 128*1024, VRAMStateDirty[1], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_C, 128*1024, VRAMStateDirty[2], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_D, 128*1024, VRAMStateDirty[3], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_E,  64*1024, VRAMStateDirty[4], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_F,  16*1024, VRAMStateDirty[5], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_G,  16*1024, VRAMStateDirty[6], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_H,  32*1024, VRAMStateDirty[7], VRAMDirtyGranularity);
+    file->VarArrayDirty(VRAM_I,  16*1024, VRAMStateDirty[8], VRAMDirtyGranularity);
 
     file->VarArray(VRAMCNT, 9);
     file->Var8(&VRAMSTAT);
@@ -361,7 +367,8 @@ void DoSavestate(Savestate* file)
     GPU2D_B.DoSavestate(file);
     GPU3D::DoSavestate(file);
 
-    ResetVRAMCache();
+    if (!file->Saving)
+        ResetVRAMCache();
 }
 
 void AssignFramebuffers()
@@ -437,6 +444,12 @@ void ResetRenderer()
 #endif
 }
 
+void SetRenderSkip(bool skip2d, bool skip3d)
+{
+    SkipRender2D = skip2d;
+    GPU3D::SetRenderSkip(skip3d);
+}
+
 void SetRenderSettings(int renderer, RenderSettings& settings)
 {
     if (renderer != Renderer)
@@ -519,6 +532,37 @@ u8* GetUniqueBankPtr(u32 mask, u32 offset)
     return &VRAM[num][offset & VRAMMask[num]];
 }
 
+u8* GetARM9VRAMPage(u32 addr)
+{
+    switch (addr & 0x00E00000)
+    {
+    case 0x00000000: return VRAMPtr_ABG[(addr >> 14) & 0x1F];
+    case 0x00200000: return VRAMPtr_BBG[(addr >> 14) & 0x7];
+    case 0x00400000: return VRAMPtr_AOBJ[(addr >> 14) & 0xF];
+    case 0x00600000: return VRAMPtr_BOBJ[(addr >> 14) & 0x7];
+    }
+
+    // LCDC: banks are laid out one after another, the rest is open bus
+    const u32 lcdcBase[9] = {0x00000, 0x20000, 0x40000, 0x60000, 0x80000, 0x90000, 0x94000, 0x98000, 0xA0000};
+    u32 offset = addr & 0xFC000;
+
+    for (int i = 0; i < 9; i++)
+    {
+        if (offset >= lcdcBase[i] && offset <= lcdcBase[i] + VRAMMask[i])
+        {
+            if (!(VRAMMap_LCDC & (1<<i))) return NULL;
+            return &VRAM[i][offset - lcdcBase[i]];
+        }
+    }
+
+    return NULL;
+}
+
+u8* GetARM7VRAMPage(u32 addr)
+{
+    return GetUniqueBankPtr(VRAMMap_ARM7[(addr >> 17) & 0x1], addr);
+}
+
 #define MAP_RANGE(map, base, n)    for (int i = 0; i < n; i++) VRAMMap_##map[(base)+i] |= bankmask;
 #define UNMAP_RANGE(map, base, n)  for (int i = 0; i < n; i++) VRAMMap_##map[(base)+i] &= ~bankmask;
 
@@ -583,6 +627,8 @@ void MapVRAM_AB(u32 bank, u8 cnt)
             break;
         }
     }
+
+    NDS::UpdateReadPages(0x06000000, 0x07000000);
 }
 
 void MapVRAM_CD(u32 bank, u8 cnt)
@@ -667,6 +713,8 @@ void MapVRAM_CD(u32 bank, u8 cnt)
             break;
         }
     }
+
+    NDS::UpdateReadPages(0x06000000, 0x07000000);
 }
 
 void MapVRAM_E(u32 bank, u8 cnt)
@@ -729,6 +777,8 @@ void MapVRAM_E(u32 bank, u8 cnt)
             break;
         }
     }
+
+    NDS::UpdateReadPages(0x06000000, 0x07000000);
 }
 
 void MapVRAM_FG(u32 bank, u8 cnt)
@@ -827,6 +877,8 @@ void MapVRAM_FG(u32 bank, u8 cnt)
             break;
         }
     }
+
+    NDS::UpdateReadPages(0x06000000, 0x07000000);
 }
 
 void MapVRAM_H(u32 bank, u8 cnt)
@@ -887,6 +939,8 @@ void MapVRAM_H(u32 bank, u8 cnt)
             break;
         }
     }
+
+    NDS::UpdateReadPages(0x06000000, 0x07000000);
 }
 
 void MapVRAM_I(u32 bank, u8 cnt)
@@ -955,6 +1009,8 @@ void MapVRAM_I(u32 bank, u8 cnt)
             break;
         }
     }
+
+    NDS::UpdateReadPages(0x06000000, 0x07000000);
 }
 
 
@@ -1021,14 +1077,14 @@ void StartHBlank(u32 line)
     {
         // draw
         // note: this should start 48 cycles after the scanline start
-        if (line < 192)
+        if (line < 192 && !SkipRender2D)
         {
             GPU2D_Renderer->DrawScanline(line, &GPU2D_A);
             GPU2D_Renderer->DrawScanline(line, &GPU2D_B);
         }
 
         // sprites are pre-rendered one scanline in advance
-        if (line < 191)
+        if (line < 191 && !SkipRender2D)
         {
             GPU2D_Renderer->DrawSprites(line+1, &GPU2D_A);
             GPU2D_Renderer->DrawSprites(line+1, &GPU2D_B);
@@ -1040,7 +1096,7 @@ void StartHBlank(u32 line)
     {
         GPU3D::VCount215();
     }
-    else if (VCount == 262)
+    else if (VCount == 262 && !SkipRender2D)
     {
         GPU2D_Renderer->DrawSprites(0, &GPU2D_A);
         GPU2D_Renderer->DrawSprites(0, &GPU2D_B);
@@ -1159,7 +1215,7 @@ void StartScanline(u32 line)
 
 #ifdef OGLRENDERER_ENABLED
             // Need a better way to identify the openGL renderer in particular
-            if (GPU3D::CurrentRenderer->Accelerated)
+            if (GPU3D::CurrentRenderer->Accelerated && !SkipRender2D)
                 CurGLCompositor->RenderFrame();
 #endif
         }
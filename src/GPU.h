@@ -90,6 +90,8 @@ extern int Renderer;
 const u32 VRAMDirtyGranularity = 512;
 
 extern NonStupidBitField<128*1024/VRAMDirtyGranularity> VRAMDirty[9];
+// same, but only reset by full savestates
+extern NonStupidBitField<128*1024/VRAMDirtyGranularity> VRAMStateDirty[9];
 
 template <u32 Size, u32 MappingGranularity>
 struct VRAMTrackingSet
@@ -183,9 +185,19 @@ void ResetRenderer();
 
 void SetRenderSettings(int renderer, RenderSettings& settings);
 
+// for frames whose video output is never shown (run-ahead)
+// skip2d: don't draw the 2D engines (display capture included)
+// skip3d: don't render the 3D scene for the next frame
+void SetRenderSkip(bool skip2d, bool skip3d);
+
 
 u8* GetUniqueBankPtr(u32 mask, u32 offset);
 
+// the VRAM behind the 16KB page at addr as seen by the ARM9/ARM7
+// NULL if nothing or more than one bank is mapped there
+u8* GetARM9VRAMPage(u32 addr);
+u8* GetARM7VRAMPage(u32 addr);
+
 void MapVRAM_AB(u32 bank, u8 cnt);
 void MapVRAM_CD(u32 bank, u8 cnt);
 void MapVRAM_E(u32 bank, u8 cnt);
@@ -323,6 +335,7 @@ void WriteVRAM_LCDC(u32 addr, T val)
     {
         *(T*)&VRAM[bank][addr] = val;
         VRAMDirty[bank][addr / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[bank][addr / VRAMDirtyGranularity] = true;
     }
 }
 
@@ -355,36 +368,43 @@ void WriteVRAM_ABG(u32 addr, T val)
     if (mask & (1<<0))
     {
         VRAMDirty[0][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[0][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_A[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<1))
     {
         VRAMDirty[1][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[1][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_B[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<2))
     {
         VRAMDirty[2][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[2][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_C[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<3))
     {
         VRAMDirty[3][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[3][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_D[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<4))
     {
         VRAMDirty[4][(addr & 0xFFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[4][(addr & 0xFFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_E[addr & 0xFFFF] = val;
     }
     if (mask & (1<<5))
     {
         VRAMDirty[5][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[5][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_F[addr & 0x3FFF] = val;
     }
     if (mask & (1<<6))
     {
         VRAMDirty[6][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[6][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_G[addr & 0x3FFF] = val;
     }
 }
@@ -416,26 +436,31 @@ void WriteVRAM_AOBJ(u32 addr, T val)
     if (mask & (1<<0))
     {
         VRAMDirty[0][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[0][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_A[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<1))
     {
         VRAMDirty[1][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[1][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_B[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<4))
     {
         VRAMDirty[4][(addr & 0xFFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[4][(addr & 0xFFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_E[addr & 0xFFFF] = val;
     }
     if (mask & (1<<5))
     {
         VRAMDirty[5][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[5][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_F[addr & 0x3FFF] = val;
     }
     if (mask & (1<<6))
     {
         VRAMDirty[6][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[6][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_G[addr & 0x3FFF] = val;
     }
 }
@@ -465,16 +490,19 @@ void WriteVRAM_BBG(u32 addr, T val)
     if (mask & (1<<2))
     {
         VRAMDirty[2][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[2][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_C[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<7))
     {
         VRAMDirty[7][(addr & 0x7FFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[7][(addr & 0x7FFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_H[addr & 0x7FFF] = val;
     }
     if (mask & (1<<8))
     {
         VRAMDirty[8][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[8][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_I[addr & 0x3FFF] = val;
     }
 }
@@ -503,11 +531,13 @@ void WriteVRAM_BOBJ(u32 addr, T val)
     if (mask & (1<<3))
     {
         VRAMDirty[3][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[3][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_D[addr & 0x1FFFF] = val;
     }
     if (mask & (1<<8))
     {
         VRAMDirty[8][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
+        VRAMStateDirty[8][(addr & 0x3FFF) / VRAMDirtyGranularity] = true;
         *(T*)&VRAM_I[addr & 0x3FFF] = val;
     }
 }
@@ -529,8 +559,16 @@ void WriteVRAM_ARM7(u32 addr, T val)
 {
     u32 mask = VRAMMap_ARM7[(addr >> 17) & 0x1];
 
-    if (mask & (1<<2)) *(T*)&VRAM_C[addr & 0x1FFFF] = val;
-    if (mask & (1<<3)) *(T*)&VRAM_D[addr & 0x1FFFF] = val;
+    if (mask & (1<<2))
+    {
+        VRAMStateDirty[2][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        *(T*)&VRAM_C[addr & 0x1FFFF] = val;
+    }
+    if (mask & (1<<3))
+    {
+        VRAMStateDirty[3][(addr & 0x1FFFF) / VRAMDirtyGranularity] = true;
+        *(T*)&VRAM_D[addr & 0x1FFFF] = val;
+    }
 }
 
 
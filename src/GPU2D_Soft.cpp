@@ -487,6 +487,8 @@ void SoftRenderer::DoCapture(u32 line, u32 width)
 
     static_assert(GPU::VRAMDirtyGranularity == 512, "");
     GPU::VRAMDirty[dstvram][(dstaddr * 2) / GPU::VRAMDirtyGranularity] = true;
+    GPU::VRAMStateDirty[dstvram][(dstaddr * 2) / GPU::VRAMDirtyGranularity] = true;
+    GPU::VRAMStateDirty[dstvram][(((dstaddr + width - 1) & 0xFFFF) * 2) / GPU::VRAMDirtyGranularity] = true;
 
     switch ((captureCnt >> 29) & 0x3)
     {
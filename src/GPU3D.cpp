@@ -180,6 +180,9 @@ u32 RenderClearAttr1, RenderClearAttr2;
 
 bool RenderFrameIdentical;
 
+bool SkipRender;
+bool RenderSkipped; // whether the last VCount215 rendered anything
+
 u16 RenderXPos;
 
 u32 ZeroDotWLimit;
@@ -309,6 +312,9 @@ void Reset()
     CmdFIFO.Clear();
     CmdPIPE.Clear();
 
+    SkipRender = false;
+    RenderSkipped = false;
+
     CmdStallQueue.Clear();
 
     NumCommands = 0;
@@ -2446,10 +2452,15 @@ void FinishWork(s32 cycles)
     GXStat &= ~(1<<27);
 }
 
+bool IsBusy()
+{
+    return !(!GeometryEnabled || FlushRequest ||
+        (CmdPIPE.IsEmpty() && !(GXStat & (1<<27))));
+}
+
 void Run()
 {
-    if (!GeometryEnabled || FlushRequest ||
-        (CmdPIPE.IsEmpty() && !(GXStat & (1<<27))))
+    if (!IsBusy())
     {
         Timestamp = NDS::ARM9Timestamp >> NDS::ARM9ClockShift;
         return;
@@ -2502,7 +2513,8 @@ void CheckFIFODMA()
 
 void VCount144()
 {
-    CurrentRenderer->VCount144();
+    if (!RenderSkipped)
+        CurrentRenderer->VCount144();
 }
 
 void RestartFrame()
@@ -2602,6 +2614,20 @@ void VBlank()
 
 void VCount215()
 {
+    RenderSkipped = SkipRender;
+    if (!RenderSkipped)
+        CurrentRenderer->RenderFrame();
+}
+
+void SetRenderSkip(bool skip)
+{
+    SkipRender = skip;
+}
+
+void RerenderFrame()
+{
+    RenderFrameIdentical = false;
+    RenderSkipped = false;
     CurrentRenderer->RenderFrame();
 }
 
@@ -112,6 +112,7 @@ void SetEnabled(bool geometry, bool rendering);
 void ExecuteCommand();
 
 s32 CyclesToRunFor();
+bool IsBusy();
 void Run();
 void CheckFIFOIRQ();
 void CheckFIFODMA();
@@ -122,6 +123,11 @@ void VCount215();
 
 void RestartFrame();
 
+void SetRenderSkip(bool skip);
+// render the 3D scene again from the current state, after loading a state
+// that the previous rendering doesn't match (run-ahead)
+void RerenderFrame();
+
 void SetRenderXPos(u16 xpos);
 u32* GetLine(int line);
 
@@ -1645,7 +1645,13 @@ void SoftRenderer::RenderPolygons(bool threaded, Polygon** polygons, int npolys)
 void SoftRenderer::VCount144()
 {
     if (RenderThreadRunning.load(std::memory_order_relaxed) && !GPU3D::AbortFrame)
+    {
         Platform::Semaphore_Wait(Sema_RenderDone);
+
+        // scanlines the 2D engine didn't read (3D layer off, frame skipped)
+        // mustn't be counted for the next frame
+        Platform::Semaphore_Reset(Sema_ScanlineCount);
+    }
 }
 
 void SoftRenderer::RenderFrame()
@@ -33,6 +33,10 @@
 #include "AREngine.h"
 #include "Platform.h"
 #include "FreeBIOS.h"
+#include "Profiling.h"
+#include "NonStupidBitfield.h"
+#include "Rewind.h"
+#include "RunAhead.h"
 
 #ifdef JIT_ENABLED
 #include "ARMJIT.h"
@@ -73,10 +77,10 @@ namespace NDS
 
 int ConsoleType;
 
-u8 ARM9MemTimings[0x40000][8];
-u32 ARM9Regions[0x40000];
-u8 ARM7MemTimings[0x20000][4];
-u32 ARM7Regions[0x20000];
+u8 ARM9RegionIndex[0x40000];
+u8 ARM9RegionTimings[32][8];
+u8 ARM7RegionIndex[0x20000];
+u8 ARM7RegionTimings[32][4];
 
 ARMv5* ARM9;
 ARMv4* ARM7;
@@ -104,7 +108,14 @@ u64 ARM7Timestamp, ARM7Target;
 u64 SysTimestamp;
 
 SchedEvent SchedList[Event_MAX];
-u32 SchedListMask;
+NonStupidBitField<Event_MAX> SchedListMask;
+
+// scheduled events, as a binary min-heap ordered by timestamp (then ID)
+// the earliest event is always at the top, so finding the next target
+// doesn't require going through the whole event list
+u32 SchedHeap[Event_MAX];
+s32 SchedHeapPos[Event_MAX]; // -1 = not in the heap
+u32 SchedHeapLen;
 
 u32 CPUStop;
 
@@ -123,6 +134,15 @@ MemRegion SWRAM_ARM7;
 
 u8* ARM7WRAM;
 
+// pages written since the last full savestate, incremental savestates only store those
+const u32 RAMDirtyGranularity = 0x1000;
+NonStupidBitField<MainRAMMaxSize/RAMDirtyGranularity> MainRAMStateDirty;
+NonStupidBitField<SharedWRAMSize/RAMDirtyGranularity> SharedWRAMStateDirty;
+NonStupidBitField<ARM7WRAMSize/RAMDirtyGranularity> ARM7WRAMStateDirty;
+
+u8* ARM9ReadPages[ReadPageCount];
+u8* ARM7ReadPages[ReadPageCount];
+
 u16 ExMemCnt[2];
 
 // TODO: these belong in NDSCart!
@@ -173,9 +193,11 @@ bool Running;
 
 bool RunningGame;
 
+void SchedHeapInsert(u32 id);
 void DivDone(u32 param);
 void SqrtDone(u32 param);
-void RunTimer(u32 tid, s32 cycles);
+void RunTimer(u32 tid, u64 cycles);
+void TimerOverflowEvent(u32 cpu);
 void SetWifiWaitCnt(u16 val);
 void SetGBASlotTimings();
 
@@ -214,6 +236,9 @@ bool Init()
 
     if (!AREngine::Init()) return false;
 
+    if (!Rewind::Init()) return false;
+    if (!RunAhead::Init()) return false;
+
     return true;
 }
 
@@ -240,6 +265,9 @@ void DeInit()
     DSi::DeInit();
 
     AREngine::DeInit();
+
+    Rewind::DeInit();
+    RunAhead::DeInit();
 }
 
 
@@ -265,24 +293,24 @@ void SetARM9RegionTimings(u32 addrstart, u32 addrend, u32 region, int buswidth,
     // nonseq accesses on the CPU get a 3-cycle penalty for all regions except main RAM
     cpuN = (region == Mem9_MainRAM) ? 0 : 3;
 
-    for (u32 i = addrstart; i < addrend; i++)
-    {
-        // CPU timings
-        ARM9MemTimings[i][0] = N16 + cpuN;
-        ARM9MemTimings[i][1] = S16;
-        ARM9MemTimings[i][2] = N32 + cpuN;
-        ARM9MemTimings[i][3] = S32;
+    u32 idx = region ? (__builtin_ctz(region) + 1) : 0;
 
-        // DMA timings
-        ARM9MemTimings[i][4] = N16;
-        ARM9MemTimings[i][5] = S16;
-        ARM9MemTimings[i][6] = N32;
-        ARM9MemTimings[i][7] = S32;
+    // CPU timings
+    ARM9RegionTimings[idx][0] = N16 + cpuN;
+    ARM9RegionTimings[idx][1] = S16;
+    ARM9RegionTimings[idx][2] = N32 + cpuN;
+    ARM9RegionTimings[idx][3] = S32;
 
-        ARM9Regions[i] = region;
-    }
+    // DMA timings
+    ARM9RegionTimings[idx][4] = N16;
+    ARM9RegionTimings[idx][5] = S16;
+    ARM9RegionTimings[idx][6] = N32;
+    ARM9RegionTimings[idx][7] = S32;
+
+    for (u32 i = addrstart; i < addrend; i++)
+        ARM9RegionIndex[i] = idx;
 
-    ARM9->UpdateRegionTimings(addrstart<<2, addrend<<2);
+    ARM9->UpdateRegionTimings();
 }
 
 void SetARM7RegionTimings(u32 addrstart, u32 addrend, u32 region, int buswidth, int nonseq, int seq)
@@ -304,16 +332,16 @@ void SetARM7RegionTimings(u32 addrstart, u32 addrend, u32 region, int buswidth,
         S32 = S16;
     }
 
-    for (u32 i = addrstart; i < addrend; i++)
-    {
-        // CPU and DMA timings are the same
-        ARM7MemTimings[i][0] = N16;
-        ARM7MemTimings[i][1] = S16;
-        ARM7MemTimings[i][2] = N32;
-        ARM7MemTimings[i][3] = S32;
+    u32 idx = region ? (__builtin_ctz(region) + 1) : 0;
 
-        ARM7Regions[i] = region;
-    }
+    // CPU and DMA timings are the same
+    ARM7RegionTimings[idx][0] = N16;
+    ARM7RegionTimings[idx][1] = S16;
+    ARM7RegionTimings[idx][2] = N32;
+    ARM7RegionTimings[idx][3] = S32;
+
+    for (u32 i = addrstart; i < addrend; i++)
+        ARM7RegionIndex[i] = idx;
 }
 
 void InitTimings()
@@ -588,6 +616,9 @@ void Reset()
     memset(MainRAM, 0, MainRAMMask + 1);
     memset(SharedWRAM, 0, 0x8000);
     memset(ARM7WRAM, 0, 0x10000);
+    MainRAMStateDirty.SetRange(0, MainRAMMaxSize/RAMDirtyGranularity);
+    SharedWRAMStateDirty.SetRange(0, SharedWRAMSize/RAMDirtyGranularity);
+    ARM7WRAMStateDirty.SetRange(0, ARM7WRAMSize/RAMDirtyGranularity);
 
     MapSharedWRAM(0);
 
@@ -641,7 +672,9 @@ void Reset()
     memset(DMA9Fill, 0, 4*4);
 
     memset(SchedList, 0, sizeof(SchedList));
-    SchedListMask = 0;
+    SchedListMask.Clear();
+    SchedHeapLen = 0;
+    for (i = 0; i < Event_MAX; i++) SchedHeapPos[i] = -1;
 
     KeyInput = 0x007F03FF;
     KeyCnt = 0;
@@ -678,6 +711,11 @@ void Reset()
     SPU::SetDegrade10Bit(degradeAudio);
 
     AREngine::Reset();
+
+    Rewind::Reset();
+    RunAhead::Reset();
+
+    UpdateReadPages(0, 0x10000000);
 }
 
 void Start()
@@ -718,6 +756,7 @@ bool DoSavestate_Scheduler(Savestate* file)
         SPI::TransferDone,
         DivDone,
         SqrtDone,
+        TimerOverflowEvent,
 
         DSi_SDHost::FinishRX,
         DSi_SDHost::FinishTX,
@@ -793,6 +832,29 @@ bool DoSavestate_Scheduler(Savestate* file)
     return true;
 }
 
+void DoSavestate_RAM(Savestate* file)
+{
+    file->Bool32(&file->Incremental);
+
+#ifdef JIT_ENABLED
+    // fastmem writes don't go through the write handlers
+    // so we can't know which pages were modified
+    if (file->Saving && file->Incremental && EnableJIT && ARMJIT::FastMemory)
+    {
+        MainRAMStateDirty.SetRange(0, MainRAMMaxSize/RAMDirtyGranularity);
+        SharedWRAMStateDirty.SetRange(0, SharedWRAMSize/RAMDirtyGranularity);
+        ARM7WRAMStateDirty.SetRange(0, ARM7WRAMSize/RAMDirtyGranularity);
+    }
+#endif
+
+    // the DS only has 4MB, no need to store the rest
+    u32 size = (ConsoleType == 0) ? 0x400000 : MainRAMMaxSize;
+
+    file->VarArrayDirty(MainRAM, size, MainRAMStateDirty, RAMDirtyGranularity);
+    file->VarArrayDirty(SharedWRAM, SharedWRAMSize, SharedWRAMStateDirty, RAMDirtyGranularity);
+    file->VarArrayDirty(ARM7WRAM, ARM7WRAMSize, ARM7WRAMStateDirty, RAMDirtyGranularity);
+}
+
 bool DoSavestate(Savestate* file)
 {
     file->Section("NDSG");
@@ -810,9 +872,12 @@ bool DoSavestate(Savestate* file)
             return false;
     }
 
-    file->VarArray(MainRAM, MainRAMMaxSize);
-    file->VarArray(SharedWRAM, SharedWRAMSize);
-    file->VarArray(ARM7WRAM, ARM7WRAMSize);
+#ifdef JIT_ENABLED
+    if (!file->Saving && EnableJIT)
+        ARMJIT::PrepareSavestateLoad();
+#endif
+
+    DoSavestate_RAM(file);
 
     //file->VarArray(ARM9BIOS, 0x1000);
     //file->VarArray(ARM7BIOS, 0x4000);
@@ -845,6 +910,12 @@ bool DoSavestate(Savestate* file)
 
     file->Var16(&DivCnt);
     file->Var16(&SqrtCnt);
+    file->VarArray(DivNumerator, 2*sizeof(u32));
+    file->VarArray(DivDenominator, 2*sizeof(u32));
+    file->VarArray(DivQuotient, 2*sizeof(u32));
+    file->VarArray(DivRemainder, 2*sizeof(u32));
+    file->VarArray(SqrtVal, 2*sizeof(u32));
+    file->Var32(&SqrtRes);
 
     file->Var32(&CPUStop);
 
@@ -863,7 +934,28 @@ bool DoSavestate(Savestate* file)
     file->VarArray(DMA9Fill, 4*sizeof(u32));
 
     if (!DoSavestate_Scheduler(file)) return false;
-    file->Var32(&SchedListMask);
+    // stored as 32-bit words, for compatibility with the old single-word mask
+    for (u32 i = 0; i < (Event_MAX+31)/32; i++)
+    {
+        u32 mask = (u32)(SchedListMask.Data[i >> 1] >> ((i & 1) * 32));
+        file->Var32(&mask);
+
+        if (!file->Saving)
+        {
+            SchedListMask.Data[i >> 1] &= ~(0xFFFFFFFFULL << ((i & 1) * 32));
+            SchedListMask.Data[i >> 1] |= (u64)mask << ((i & 1) * 32);
+        }
+    }
+    if (!file->Saving)
+    {
+        SchedHeapLen = 0;
+        for (u32 i = 0; i < Event_MAX; i++)
+        {
+            SchedHeapPos[i] = -1;
+            if (SchedListMask[i])
+                SchedHeapInsert(i);
+        }
+    }
     file->Var64(&ARM9Timestamp);
     file->Var64(&ARM9Target);
     file->Var64(&ARM7Timestamp);
@@ -889,7 +981,8 @@ bool DoSavestate(Savestate* file)
         // but we do need to update the mappings
         MapSharedWRAM(WRAMCnt);
 
-        InitTimings();
+        // the base timing tables only depend on the console type
+        // only the GBA slot and wifi ranges are affected by the saved registers
         SetGBASlotTimings();
 
         u16 tmp = WifiWaitCnt;
@@ -918,12 +1011,19 @@ bool DoSavestate(Savestate* file)
     if (!file->Saving)
     {
         GPU::SetPowerCnt(PowerControl9);
+
+        UpdateReadPages(0, 0x10000000);
+
+        // the CPUs' pending IRQ lines aren't stored, they follow from IME/IE/IF
+        UpdateIRQ(0);
+        UpdateIRQ(1);
     }
 
 #ifdef JIT_ENABLED
-    if (!file->Saving)
+    // the block cache isn't used by the interpreter, and is reset when the JIT gets enabled
+    if (!file->Saving && EnableJIT)
     {
-        ARMJIT::ResetBlockCache();
+        ARMJIT::FinishSavestateLoad();
         ARMJIT_Memory::Reset();
     }
 #endif
@@ -990,23 +1090,87 @@ void LoadBIOS()
 }
 
 
-u64 NextTarget()
+bool SchedEventBefore(u32 a, u32 b)
+{
+    if (SchedList[a].Timestamp != SchedList[b].Timestamp)
+        return SchedList[a].Timestamp < SchedList[b].Timestamp;
+
+    return a < b;
+}
+
+void SchedHeapSet(u32 pos, u32 id)
+{
+    SchedHeap[pos] = id;
+    SchedHeapPos[id] = pos;
+}
+
+void SchedHeapSiftUp(u32 pos)
 {
-    u64 minEvent = UINT64_MAX;
+    u32 id = SchedHeap[pos];
 
-    u32 mask = SchedListMask;
-    for (int i = 0; i < Event_MAX; i++)
+    while (pos > 0)
     {
-        if (!mask) break;
-        if (mask & 0x1)
-        {
-            if (SchedList[i].Timestamp < minEvent)
-                minEvent = SchedList[i].Timestamp;
-        }
+        u32 parent = (pos - 1) >> 1;
+        if (!SchedEventBefore(id, SchedHeap[parent]))
+            break;
 
-        mask >>= 1;
+        SchedHeapSet(pos, SchedHeap[parent]);
+        pos = parent;
     }
 
+    SchedHeapSet(pos, id);
+}
+
+void SchedHeapSiftDown(u32 pos)
+{
+    u32 id = SchedHeap[pos];
+
+    for (;;)
+    {
+        u32 child = (pos << 1) + 1;
+        if (child >= SchedHeapLen)
+            break;
+
+        if ((child+1) < SchedHeapLen && SchedEventBefore(SchedHeap[child+1], SchedHeap[child]))
+            child++;
+
+        if (!SchedEventBefore(SchedHeap[child], id))
+            break;
+
+        SchedHeapSet(pos, SchedHeap[child]);
+        pos = child;
+    }
+
+    SchedHeapSet(pos, id);
+}
+
+void SchedHeapInsert(u32 id)
+{
+    SchedHeapSet(SchedHeapLen, id);
+    SchedHeapSiftUp(SchedHeapLen++);
+}
+
+void SchedHeapRemove(u32 id)
+{
+    s32 pos = SchedHeapPos[id];
+    if (pos < 0) return;
+
+    SchedHeapPos[id] = -1;
+    SchedHeapLen--;
+    if ((u32)pos == SchedHeapLen)
+        return;
+
+    u32 moved = SchedHeap[SchedHeapLen];
+    SchedHeapSet(pos, moved);
+    SchedHeapSiftUp(pos);
+    if (SchedHeapPos[moved] == pos)
+        SchedHeapSiftDown(pos);
+}
+
+u64 NextTarget()
+{
+    u64 minEvent = SchedHeapLen ? SchedList[SchedHeap[0]].Timestamp : UINT64_MAX;
+
     u64 max = SysTimestamp + kMaxIterationCycles;
 
     if (minEvent < max + kIterationCycleMargin)
@@ -1019,20 +1183,29 @@ void RunSystem(u64 timestamp)
 {
     SysTimestamp = timestamp;
 
-    u32 mask = SchedListMask;
-    for (int i = 0; i < Event_MAX; i++)
+    // take all the due events out of the queue first
+    // events rescheduled by their callback will only run on the next pass
+    u32 due[Event_MAX];
+    u32 numdue = 0;
+
+    while (SchedHeapLen && SchedList[SchedHeap[0]].Timestamp <= SysTimestamp)
     {
-        if (!mask) break;
-        if (mask & 0x1)
-        {
-            if (SchedList[i].Timestamp <= SysTimestamp)
-            {
-                SchedListMask &= ~(1<<i);
-                SchedList[i].Func(SchedList[i].Param);
-            }
-        }
+        due[numdue++] = SchedHeap[0];
+        SchedHeapRemove(SchedHeap[0]);
+    }
+
+    for (u32 i = 0; i < numdue; i++)
+    {
+        u32 id = due[i];
 
-        mask >>= 1;
+        // cancelled by an earlier callback (and possibly rescheduled)
+        if (!SchedListMask[id] || SchedHeapPos[id] >= 0)
+            continue;
+
+        PROFILE_START(start);
+        SchedListMask[id] = false;
+        SchedList[id].Func(SchedList[id].Param);
+        PROFILE_END_EVENT(id, start);
     }
 }
 
@@ -1049,6 +1222,29 @@ u32 RunFrame()
 
         while (Running && GPU::TotalScanlines==0)
         {
+            if (SchedHeapLen && ARM9->Halted == 1 && ARM7->Halted == 1 && !CPUStop &&
+                !HaltInterrupted(0) && !HaltInterrupted(1) && !GPU3D::IsBusy())
+            {
+                // both CPUs are waiting for an IRQ, and only an event can raise one
+                // skip straight to the next event instead of going slice by slice
+                PROFILE_START(start);
+                u64 target = SchedList[SchedHeap[0]].Timestamp;
+
+                // either CPU might already be past the event
+                if (ARM9Timestamp < (target << ARM9ClockShift))
+                {
+                    ARM9Timestamp = target << ARM9ClockShift;
+                    GPU3D::Timestamp = target;
+                }
+                if (ARM7Timestamp < target)
+                    ARM7Timestamp = target;
+
+                CurCPU = 1;
+                RunSystem(target);
+                PROFILE_END(Profiling::Prof_Events, start);
+                continue;
+            }
+
             u64 target = NextTarget();
             ARM9Target = target << ARM9ClockShift;
             CurCPU = 0;
@@ -1062,24 +1258,31 @@ u32 RunFrame()
             }
             else if (CPUStop & 0x0FFF)
             {
+                PROFILE_START(start);
                 DMAs[0]->Run<ConsoleType>();
                 if (!(CPUStop & 0x80000000)) DMAs[1]->Run<ConsoleType>();
                 if (!(CPUStop & 0x80000000)) DMAs[2]->Run<ConsoleType>();
                 if (!(CPUStop & 0x80000000)) DMAs[3]->Run<ConsoleType>();
                 if (ConsoleType == 1) DSi::RunNDMAs(0);
+                PROFILE_END(Profiling::Prof_DMA9, start);
             }
             else
             {
+                PROFILE_START(start);
 #ifdef JIT_ENABLED
                 if (EnableJIT)
                     ARM9->ExecuteJIT();
                 else
 #endif
                     ARM9->Execute();
+                PROFILE_END(Profiling::Prof_ARM9, start);
             }
 
-            RunTimers(0);
-            GPU3D::Run();
+            {
+                PROFILE_START(start);
+                GPU3D::Run();
+                PROFILE_END(Profiling::Prof_GPU3D, start);
+            }
 
             target = ARM9Timestamp >> ARM9ClockShift;
             CurCPU = 1;
@@ -1090,26 +1293,32 @@ u32 RunFrame()
 
                 if (CPUStop & 0x0FFF0000)
                 {
+                    PROFILE_START(start);
                     DMAs[4]->Run<ConsoleType>();
                     DMAs[5]->Run<ConsoleType>();
                     DMAs[6]->Run<ConsoleType>();
                     DMAs[7]->Run<ConsoleType>();
                     if (ConsoleType == 1) DSi::RunNDMAs(1);
+                    PROFILE_END(Profiling::Prof_DMA7, start);
                 }
                 else
                 {
+                    PROFILE_START(start);
 #ifdef JIT_ENABLED
                     if (EnableJIT)
                         ARM7->ExecuteJIT();
                     else
 #endif
                         ARM7->Execute();
+                    PROFILE_END(Profiling::Prof_ARM7, start);
                 }
-
-                RunTimers(1);
             }
 
-            RunSystem(target);
+            {
+                PROFILE_START(start);
+                RunSystem(target);
+                PROFILE_END(Profiling::Prof_Events, start);
+            }
 
             if (CPUStop & 0x40000000)
             {
@@ -1172,7 +1381,7 @@ void Reschedule(u64 target)
 
 void ScheduleEvent(u32 id, bool periodic, s32 delay, void (*func)(u32), u32 param)
 {
-    if (SchedListMask & (1<<id))
+    if (SchedListMask[id])
     {
         printf("!! EVENT %d ALREADY SCHEDULED\n", id);
         return;
@@ -1193,14 +1402,19 @@ void ScheduleEvent(u32 id, bool periodic, s32 delay, void (*func)(u32), u32 para
     evt->Func = func;
     evt->Param = param;
 
-    SchedListMask |= (1<<id);
+    SchedListMask[id] = true;
+    SchedHeapInsert(id);
 
     Reschedule(evt->Timestamp);
 }
 
 void CancelEvent(u32 id)
 {
-    SchedListMask &= ~(1<<id);
+    if (!SchedListMask[id])
+        return;
+
+    SchedListMask[id] = false;
+    SchedHeapRemove(id);
 }
 
 
@@ -1320,6 +1534,62 @@ void MapSharedWRAM(u8 val)
         SWRAM_ARM7.Mask = 0x7FFF;
         break;
     }
+
+    UpdateReadPages(0x03000000, 0x04000000);
+
+    // either CPU might be running code from shared WRAM
+    ARM9->SetupCodeMem(ARM9->R[15]);
+    ARM7->SetupCodeMem(ARM7->R[15]);
+}
+
+u8* GetARM9ReadPage(u32 addr)
+{
+    switch (addr & 0xFF000000)
+    {
+    case 0x02000000:
+        return &MainRAM[addr & MainRAMMask];
+
+    case 0x03000000:
+        if (SWRAM_ARM9.Mem) return &SWRAM_ARM9.Mem[addr & SWRAM_ARM9.Mask];
+        return NULL;
+
+    case 0x06000000:
+        return GPU::GetARM9VRAMPage(addr);
+    }
+
+    return NULL;
+}
+
+u8* GetARM7ReadPage(u32 addr)
+{
+    switch (addr & 0xFF800000)
+    {
+    case 0x02000000:
+    case 0x02800000:
+        return &MainRAM[addr & MainRAMMask];
+
+    case 0x03000000:
+        if (SWRAM_ARM7.Mem) return &SWRAM_ARM7.Mem[addr & SWRAM_ARM7.Mask];
+        return &ARM7WRAM[addr & (ARM7WRAMSize - 1)];
+
+    case 0x03800000:
+        return &ARM7WRAM[addr & (ARM7WRAMSize - 1)];
+
+    case 0x06000000:
+    case 0x06800000:
+        return GPU::GetARM7VRAMPage(addr);
+    }
+
+    return NULL;
+}
+
+void UpdateReadPages(u32 start, u32 end)
+{
+    for (u32 addr = start; addr < end; addr += ReadPageSize)
+    {
+        ARM9ReadPages[addr >> ReadPageShift] = GetARM9ReadPage(addr);
+        ARM7ReadPages[addr >> ReadPageShift] = GetARM7ReadPage(addr);
+    }
 }
 
 
@@ -1645,11 +1915,34 @@ void HandleTimerOverflow(u32 tid)
     }
 }
 
-void RunTimer(u32 tid, s32 cycles)
+bool TimerNeedsEvent(u32 tid)
+{
+    // an overflow is only observable through its IRQ or a cascading timer
+    // otherwise, the counter can just be caught up when it is read
+    if (Timers[tid].Cnt & (1<<6))
+        return true;
+
+    if ((tid & 0x3) == 3)
+        return false;
+
+    return (Timers[tid+1].Cnt & 0x84) == 0x84;
+}
+
+void RunTimer(u32 tid, u64 cycles)
 {
     Timer* timer = &Timers[tid];
 
-    timer->Counter += (cycles << timer->CycleShift);
+    u64 counter = timer->Counter + (cycles << timer->CycleShift);
+
+    if ((counter >> 26) && !TimerNeedsEvent(tid))
+    {
+        // nobody is watching the overflows, skip them all at once
+        u64 reload = timer->Reload << 10;
+        timer->Counter = reload + ((counter - (1 << 26)) % ((1 << 26) - reload));
+        return;
+    }
+
+    timer->Counter = (u32)counter;
     while (timer->Counter >> 26)
     {
         timer->Counter -= (1 << 26);
@@ -1660,7 +1953,7 @@ void RunTimer(u32 tid, s32 cycles)
 void RunTimers(u32 cpu)
 {
     u32 timermask = TimerCheckMask[cpu];
-    s32 cycles;
+    u64 cycles;
 
     if (cpu == 0)
         cycles = (ARM9Timestamp >> ARM9ClockShift) - TimerTimestamp[0];
@@ -1675,6 +1968,50 @@ void RunTimers(u32 cpu)
     TimerTimestamp[cpu] += cycles;
 }
 
+void ScheduleTimerEvent(u32 cpu)
+{
+    // schedule the next overflow that needs to be seen
+    // (timers must have been caught up beforehand)
+    u32 timermask = TimerCheckMask[cpu];
+    u64 next = UINT64_MAX;
+
+    for (u32 i = 0; i < 4; i++)
+    {
+        u32 tid = (cpu<<2) + i;
+        if (!(timermask & (1<<i)) || !TimerNeedsEvent(tid))
+            continue;
+
+        Timer* timer = &Timers[tid];
+        u32 left = (1 << 26) - timer->Counter;
+        u64 time = TimerTimestamp[cpu] + ((left + (1 << timer->CycleShift) - 1) >> timer->CycleShift);
+        if (time < next) next = time;
+    }
+
+    u32 id = Event_Timer9 + cpu;
+    if (next == UINT64_MAX)
+    {
+        CancelEvent(id);
+        return;
+    }
+
+    if (SchedListMask[id])
+    {
+        if (SchedList[id].Timestamp == next)
+            return;
+
+        CancelEvent(id);
+    }
+
+    u64 now = (CurCPU == 0) ? (ARM9Timestamp >> ARM9ClockShift) : ARM7Timestamp;
+    ScheduleEvent(id, false, (s32)(next - now), TimerOverflowEvent, cpu);
+}
+
+void TimerOverflowEvent(u32 cpu)
+{
+    RunTimers(cpu);
+    ScheduleTimerEvent(cpu);
+}
+
 const s32 TimerPrescaler[4] = {0, 6, 8, 10};
 
 u16 TimerGetCounter(u32 timer)
@@ -1685,6 +2022,14 @@ u16 TimerGetCounter(u32 timer)
     return ret >> 10;
 }
 
+void TimerSetReload(u32 id, u16 val)
+{
+    // overflows that already happened have to use the old reload value
+    RunTimers(id>>2);
+
+    Timers[id].Reload = val;
+}
+
 void TimerStart(u32 id, u16 cnt)
 {
     Timer* timer = &Timers[id];
@@ -1705,6 +2050,8 @@ void TimerStart(u32 id, u16 cnt)
         TimerCheckMask[id>>2] |= 0x01 << (id&0x3);
     else
         TimerCheckMask[id>>2] &= ~(0x01 << (id&0x3));
+
+    ScheduleTimerEvent(id>>2);
 }
 
 
@@ -1977,6 +2324,12 @@ void debug(u32 param)
 
 u8 ARM9Read8(u32 addr)
 {
+    if (addr < 0x10000000)
+    {
+        u8* page = ARM9ReadPages[addr >> ReadPageShift];
+        if (page) return *(u8*)&page[addr & (ReadPageSize - 1)];
+    }
+
     if ((addr & 0xFFFFF000) == 0xFFFF0000)
     {
         return *(u8*)&ARM9BIOS[addr & 0xFFF];
@@ -2035,6 +2388,12 @@ u8 ARM9Read8(u32 addr)
 
 u16 ARM9Read16(u32 addr)
 {
+    if (addr < 0x10000000)
+    {
+        u8* page = ARM9ReadPages[addr >> ReadPageShift];
+        if (page) return *(u16*)&page[addr & (ReadPageSize - 1)];
+    }
+
     if ((addr & 0xFFFFF000) == 0xFFFF0000)
     {
         return *(u16*)&ARM9BIOS[addr & 0xFFF];
@@ -2093,6 +2452,12 @@ u16 ARM9Read16(u32 addr)
 
 u32 ARM9Read32(u32 addr)
 {
+    if (addr < 0x10000000)
+    {
+        u8* page = ARM9ReadPages[addr >> ReadPageShift];
+        if (page) return *(u32*)&page[addr & (ReadPageSize - 1)];
+    }
+
     if ((addr & 0xFFFFF000) == 0xFFFF0000)
     {
         return *(u32*)&ARM9BIOS[addr & 0xFFF];
@@ -2161,6 +2526,7 @@ void ARM9Write8(u32 addr, u8 val)
         ARMJIT::CheckAndInvalidate<0, ARMJIT_Memory::memregion_MainRAM>(addr);
 #endif
         *(u8*)&MainRAM[addr & MainRAMMask] = val;
+        MainRAMStateDirty[(addr & MainRAMMask) / RAMDirtyGranularity] = true;
         return;
 
     case 0x03000000:
@@ -2170,6 +2536,7 @@ void ARM9Write8(u32 addr, u8 val)
             ARMJIT::CheckAndInvalidate<0, ARMJIT_Memory::memregion_SharedWRAM>(addr);
 #endif
             *(u8*)&SWRAM_ARM9.Mem[addr & SWRAM_ARM9.Mask] = val;
+            SharedWRAMStateDirty[(SWRAM_ARM9.Mem - SharedWRAM + (addr & SWRAM_ARM9.Mask)) / RAMDirtyGranularity] = true;
         }
         return;
 
@@ -2204,6 +2571,7 @@ void ARM9Write16(u32 addr, u16 val)
         ARMJIT::CheckAndInvalidate<0, ARMJIT_Memory::memregion_MainRAM>(addr);
 #endif
         *(u16*)&MainRAM[addr & MainRAMMask] = val;
+        MainRAMStateDirty[(addr & MainRAMMask) / RAMDirtyGranularity] = true;
         return;
 
     case 0x03000000:
@@ -2213,6 +2581,7 @@ void ARM9Write16(u32 addr, u16 val)
             ARMJIT::CheckAndInvalidate<0, ARMJIT_Memory::memregion_SharedWRAM>(addr);
 #endif
             *(u16*)&SWRAM_ARM9.Mem[addr & SWRAM_ARM9.Mask] = val;
+            SharedWRAMStateDirty[(SWRAM_ARM9.Mem - SharedWRAM + (addr & SWRAM_ARM9.Mask)) / RAMDirtyGranularity] = true;
         }
         return;
 
@@ -2268,6 +2637,7 @@ void ARM9Write32(u32 addr, u32 val)
         ARMJIT::CheckAndInvalidate<0, ARMJIT_Memory::memregion_MainRAM>(addr);
 #endif
         *(u32*)&MainRAM[addr & MainRAMMask] = val;
+        MainRAMStateDirty[(addr & MainRAMMask) / RAMDirtyGranularity] = true;
         return ;
 
     case 0x03000000:
@@ -2277,6 +2647,7 @@ void ARM9Write32(u32 addr, u32 val)
             ARMJIT::CheckAndInvalidate<0, ARMJIT_Memory::memregion_SharedWRAM>(addr);
 #endif
             *(u32*)&SWRAM_ARM9.Mem[addr & SWRAM_ARM9.Mask] = val;
+            SharedWRAMStateDirty[(SWRAM_ARM9.Mem - SharedWRAM + (addr & SWRAM_ARM9.Mask)) / RAMDirtyGranularity] = true;
         }
         return;
 
@@ -2360,6 +2731,12 @@ bool ARM9GetMemRegion(u32 addr, bool write, MemRegion* region)
 
 u8 ARM7Read8(u32 addr)
 {
+    if (addr < 0x10000000)
+    {
+        u8* page = ARM7ReadPages[addr >> ReadPageShift];
+        if (page) return *(u8*)&page[addr & (ReadPageSize - 1)];
+    }
+
     if (addr < 0x00004000)
     {
         // TODO: check the boundary? is it 4000 or higher on regular DS?
@@ -2425,6 +2802,12 @@ u8 ARM7Read8(u32 addr)
 
 u16 ARM7Read16(u32 addr)
 {
+    if (addr < 0x10000000)
+    {
+        u8* page = ARM7ReadPages[addr >> ReadPageShift];
+        if (page) return *(u16*)&page[addr & (ReadPageSize - 1)];
+    }
+
     if (addr < 0x00004000)
     {
         if (ARM7->R[15] >= 0x00004000)
@@ -2488,6 +2871,12 @@ u16 ARM7Read16(u32 addr)
 
 u32 ARM7Read32(u32 addr)
 {
+    if (addr < 0x10000000)
+    {
+        u8* page = ARM7ReadPages[addr >> ReadPageShift];
+        if (page) return *(u32*)&page[addr & (ReadPageSize - 1)];
+    }
+
     if (addr < 0x00004000)
     {
         if (ARM7->R[15] >= 0x00004000)
@@ -2562,6 +2951,7 @@ void ARM7Write8(u32 addr, u8 val)
         ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_MainRAM>(addr);
 #endif
         *(u8*)&MainRAM[addr & MainRAMMask] = val;
+        MainRAMStateDirty[(addr & MainRAMMask) / RAMDirtyGranularity] = true;
         return;
 
     case 0x03000000:
@@ -2571,6 +2961,7 @@ void ARM7Write8(u32 addr, u8 val)
             ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_SharedWRAM>(addr);
 #endif
             *(u8*)&SWRAM_ARM7.Mem[addr & SWRAM_ARM7.Mask] = val;
+            SharedWRAMStateDirty[(SWRAM_ARM7.Mem - SharedWRAM + (addr & SWRAM_ARM7.Mask)) / RAMDirtyGranularity] = true;
             return;
         }
         else
@@ -2579,6 +2970,7 @@ void ARM7Write8(u32 addr, u8 val)
             ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_WRAM7>(addr);
 #endif
             *(u8*)&ARM7WRAM[addr & (ARM7WRAMSize - 1)] = val;
+            ARM7WRAMStateDirty[(addr & (ARM7WRAMSize - 1)) / RAMDirtyGranularity] = true;
             return;
         }
 
@@ -2587,6 +2979,7 @@ void ARM7Write8(u32 addr, u8 val)
         ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_WRAM7>(addr);
 #endif
         *(u8*)&ARM7WRAM[addr & (ARM7WRAMSize - 1)] = val;
+        ARM7WRAMStateDirty[(addr & (ARM7WRAMSize - 1)) / RAMDirtyGranularity] = true;
         return;
 
     case 0x04000000:
@@ -2628,6 +3021,7 @@ void ARM7Write16(u32 addr, u16 val)
         ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_MainRAM>(addr);
 #endif
         *(u16*)&MainRAM[addr & MainRAMMask] = val;
+        MainRAMStateDirty[(addr & MainRAMMask) / RAMDirtyGranularity] = true;
         return;
 
     case 0x03000000:
@@ -2637,6 +3031,7 @@ void ARM7Write16(u32 addr, u16 val)
             ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_SharedWRAM>(addr);
 #endif
             *(u16*)&SWRAM_ARM7.Mem[addr & SWRAM_ARM7.Mask] = val;
+            SharedWRAMStateDirty[(SWRAM_ARM7.Mem - SharedWRAM + (addr & SWRAM_ARM7.Mask)) / RAMDirtyGranularity] = true;
             return;
         }
         else
@@ -2645,6 +3040,7 @@ void ARM7Write16(u32 addr, u16 val)
             ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_WRAM7>(addr);
 #endif
             *(u16*)&ARM7WRAM[addr & (ARM7WRAMSize - 1)] = val;
+            ARM7WRAMStateDirty[(addr & (ARM7WRAMSize - 1)) / RAMDirtyGranularity] = true;
             return;
         }
 
@@ -2653,6 +3049,7 @@ void ARM7Write16(u32 addr, u16 val)
         ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_WRAM7>(addr);
 #endif
         *(u16*)&ARM7WRAM[addr & (ARM7WRAMSize - 1)] = val;
+        ARM7WRAMStateDirty[(addr & (ARM7WRAMSize - 1)) / RAMDirtyGranularity] = true;
         return;
 
     case 0x04000000:
@@ -2704,6 +3101,7 @@ void ARM7Write32(u32 addr, u32 val)
         ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_MainRAM>(addr);
 #endif
         *(u32*)&MainRAM[addr & MainRAMMask] = val;
+        MainRAMStateDirty[(addr & MainRAMMask) / RAMDirtyGranularity] = true;
         return;
 
     case 0x03000000:
@@ -2713,6 +3111,7 @@ void ARM7Write32(u32 addr, u32 val)
             ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_SharedWRAM>(addr);
 #endif
             *(u32*)&SWRAM_ARM7.Mem[addr & SWRAM_ARM7.Mask] = val;
+            SharedWRAMStateDirty[(SWRAM_ARM7.Mem - SharedWRAM + (addr & SWRAM_ARM7.Mask)) / RAMDirtyGranularity] = true;
             return;
         }
         else
@@ -2721,6 +3120,7 @@ void ARM7Write32(u32 addr, u32 val)
             ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_WRAM7>(addr);
 #endif
             *(u32*)&ARM7WRAM[addr & (ARM7WRAMSize - 1)] = val;
+            ARM7WRAMStateDirty[(addr & (ARM7WRAMSize - 1)) / RAMDirtyGranularity] = true;
             return;
         }
 
@@ -2729,6 +3129,7 @@ void ARM7Write32(u32 addr, u32 val)
         ARMJIT::CheckAndInvalidate<1, ARMJIT_Memory::memregion_WRAM7>(addr);
 #endif
         *(u32*)&ARM7WRAM[addr & (ARM7WRAMSize - 1)] = val;
+        ARM7WRAMStateDirty[(addr & (ARM7WRAMSize - 1)) / RAMDirtyGranularity] = true;
         return;
 
     case 0x04000000:
@@ -3337,13 +3738,13 @@ void ARM9IOWrite16(u32 addr, u16 val)
     case 0x040000EC: DMA9Fill[3] = (DMA9Fill[3] & 0xFFFF0000) | val; return;
     case 0x040000EE: DMA9Fill[3] = (DMA9Fill[3] & 0x0000FFFF) | (val << 16); return;
 
-    case 0x04000100: Timers[0].Reload = val; return;
+    case 0x04000100: TimerSetReload(0, val); return;
     case 0x04000102: TimerStart(0, val); return;
-    case 0x04000104: Timers[1].Reload = val; return;
+    case 0x04000104: TimerSetReload(1, val); return;
     case 0x04000106: TimerStart(1, val); return;
-    case 0x04000108: Timers[2].Reload = val; return;
+    case 0x04000108: TimerSetReload(2, val); return;
     case 0x0400010A: TimerStart(2, val); return;
-    case 0x0400010C: Timers[3].Reload = val; return;
+    case 0x0400010C: TimerSetReload(3, val); return;
     case 0x0400010E: TimerStart(3, val); return;
 
     case 0x04000132:
@@ -3523,19 +3924,19 @@ void ARM9IOWrite32(u32 addr, u32 val)
     case 0x040000EC: DMA9Fill[3] = val; return;
 
     case 0x04000100:
-        Timers[0].Reload = val & 0xFFFF;
+        TimerSetReload(0, val & 0xFFFF);
         TimerStart(0, val>>16);
         return;
     case 0x04000104:
-        Timers[1].Reload = val & 0xFFFF;
+        TimerSetReload(1, val & 0xFFFF);
         TimerStart(1, val>>16);
         return;
     case 0x04000108:
-        Timers[2].Reload = val & 0xFFFF;
+        TimerSetReload(2, val & 0xFFFF);
         TimerStart(2, val>>16);
         return;
     case 0x0400010C:
-        Timers[3].Reload = val & 0xFFFF;
+        TimerSetReload(3, val & 0xFFFF);
         TimerStart(3, val>>16);
         return;
 
@@ -4042,13 +4443,13 @@ void ARM7IOWrite16(u32 addr, u16 val)
     case 0x040000DC: DMAs[7]->WriteCnt((DMAs[7]->Cnt & 0xFFFF0000) | val); return;
     case 0x040000DE: DMAs[7]->WriteCnt((DMAs[7]->Cnt & 0x0000FFFF) | (val << 16)); return;
 
-    case 0x04000100: Timers[4].Reload = val; return;
+    case 0x04000100: TimerSetReload(4, val); return;
     case 0x04000102: TimerStart(4, val); return;
-    case 0x04000104: Timers[5].Reload = val; return;
+    case 0x04000104: TimerSetReload(5, val); return;
     case 0x04000106: TimerStart(5, val); return;
-    case 0x04000108: Timers[6].Reload = val; return;
+    case 0x04000108: TimerSetReload(6, val); return;
     case 0x0400010A: TimerStart(6, val); return;
-    case 0x0400010C: Timers[7].Reload = val; return;
+    case 0x0400010C: TimerSetReload(7, val); return;
     case 0x0400010E: TimerStart(7, val); return;
 
     case 0x04000132: KeyCnt = val; return;
@@ -4195,19 +4596,19 @@ void ARM7IOWrite32(u32 addr, u32 val)
     case 0x040000DC: DMAs[7]->WriteCnt(val); return;
 
     case 0x04000100:
-        Timers[4].Reload = val & 0xFFFF;
+        TimerSetReload(4, val & 0xFFFF);
         TimerStart(4, val>>16);
         return;
     case 0x04000104:
-        Timers[5].Reload = val & 0xFFFF;
+        TimerSetReload(5, val & 0xFFFF);
         TimerStart(5, val>>16);
         return;
     case 0x04000108:
-        Timers[6].Reload = val & 0xFFFF;
+        TimerSetReload(6, val & 0xFFFF);
         TimerStart(6, val>>16);
         return;
     case 0x0400010C:
-        Timers[7].Reload = val & 0xFFFF;
+        TimerSetReload(7, val & 0xFFFF);
         TimerStart(7, val>>16);
         return;
 
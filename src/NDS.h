@@ -43,6 +43,8 @@ enum
     Event_SPITransfer,
     Event_Div,
     Event_Sqrt,
+    Event_Timer9,
+    Event_Timer7,
 
     // DSi
     Event_DSi_SDMMCTransfer,
@@ -174,10 +176,30 @@ extern bool EnableJIT;
 extern int ConsoleType;
 extern int CurCPU;
 
-extern u8 ARM9MemTimings[0x40000][8];
-extern u32 ARM9Regions[0x40000];
-extern u8 ARM7MemTimings[0x20000][4];
-extern u32 ARM7Regions[0x20000];
+// bus timings are stored once per region (Mem9_*/Mem7_*), indexed by the
+// position of the region's bit plus one (0 being unmapped memory)
+// every 16KB (ARM9) or 32KB (ARM7) page only stores the index of its region
+// ARM9: CPU N16 S16 N32 S32, then DMA N16 S16 N32 S32
+// ARM7: N16 S16 N32 S32, for both CPU and DMA
+extern u8 ARM9RegionIndex[0x40000];
+extern u8 ARM9RegionTimings[32][8];
+extern u8 ARM7RegionIndex[0x20000];
+extern u8 ARM7RegionTimings[32][4];
+
+inline u8* ARM9MemTimings(u32 page) { return ARM9RegionTimings[ARM9RegionIndex[page]]; }
+inline u8* ARM7MemTimings(u32 page) { return ARM7RegionTimings[ARM7RegionIndex[page]]; }
+
+inline u32 ARM9Region(u32 page)
+{
+    u32 idx = ARM9RegionIndex[page];
+    return idx ? (1 << (idx - 1)) : 0;
+}
+
+inline u32 ARM7Region(u32 page)
+{
+    u32 idx = ARM7RegionIndex[page];
+    return idx ? (1 << (idx - 1)) : 0;
+}
 
 extern u32 NumFrames;
 extern u32 NumLagFrames;
@@ -192,6 +214,7 @@ extern u32 IE[2];
 extern u32 IF[2];
 extern u32 IE2;
 extern u32 IF2;
+extern u16 IPCSync9, IPCSync7;
 extern Timer Timers[8];
 
 extern u32 CPUStop;
@@ -222,6 +245,16 @@ extern u32 KeyInput;
 const u32 ARM7WRAMSize = 0x10000;
 extern u8* ARM7WRAM;
 
+// direct pointers to the memory behind each 16KB page of the first 256MB
+// of either CPU's address space, for pages which can be read without side effects
+// (main RAM, WRAM, VRAM mapped to a single bank)
+// NULL pages go through the regular read handlers
+const u32 ReadPageShift = 14;
+const u32 ReadPageSize = 1 << ReadPageShift;
+const u32 ReadPageCount = 0x10000000 >> ReadPageShift;
+extern u8* ARM9ReadPages[ReadPageCount];
+extern u8* ARM7ReadPages[ReadPageCount];
+
 bool Init();
 void DeInit();
 void Reset();
@@ -271,6 +304,9 @@ void Halt();
 
 void MapSharedWRAM(u8 val);
 
+// has to be called whenever the memory mapped to the given range changes
+void UpdateReadPages(u32 start, u32 end);
+
 void UpdateIRQ(u32 cpu);
 void SetIRQ(u32 cpu, u32 irq);
 void ClearIRQ(u32 cpu, u32 irq);
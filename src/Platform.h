@@ -22,6 +22,7 @@
 #include "types.h"
 
 #include <functional>
+#include <string>
 #ifdef __LIBRETRO__
 #undef __LIBRETRO_SDK_FILE_STREAM_TRANSFORMS_H
 #include <streams/file_stream.h>
@@ -51,6 +52,8 @@ enum ConfigEntry
     JIT_LiteralOptimizations,
     JIT_BranchOptimizations,
     JIT_FastMemory,
+    JIT_AsyncCompilation,
+    JIT_TieredCompilation,
 #endif
 
     ExternalBIOSEnable,
@@ -89,6 +92,13 @@ enum ConfigEntry
     Firm_RandomizeMAC,
 
     AudioBitrate,
+
+    Rewind_Enable,
+    Rewind_Length,
+    Rewind_Interval,
+    Rewind_MaxMemory,
+
+    RunAhead_Frames,
 };
 
 int GetConfigInt(ConfigEntry entry);
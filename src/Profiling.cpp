@@ -0,0 +1,83 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <string.h>
+#include <chrono>
+#include "Profiling.h"
+#include "NDS.h"
+
+namespace Profiling
+{
+
+Counter Counters[Prof_MAX];
+Counter EventCounters[NDS::Event_MAX];
+
+const char* Names[Prof_MAX] =
+{
+    "ARM9",
+    "ARM7",
+    "DMA9",
+    "DMA7",
+    "GPU3D",
+    "events",
+};
+
+const char* GetName(int id)
+{
+    return Names[id];
+}
+
+void Reset()
+{
+    memset(Counters, 0, sizeof(Counters));
+    memset(EventCounters, 0, sizeof(EventCounters));
+}
+
+const Counter& Get(int id)
+{
+    return Counters[id];
+}
+
+const Counter& GetEvent(int id)
+{
+    return EventCounters[id];
+}
+
+#ifdef CORE_PROFILING_ENABLED
+
+u64 Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Add(int id, u64 start)
+{
+    Counters[id].Time += Now() - start;
+    Counters[id].Calls++;
+}
+
+void AddEvent(int id, u64 start)
+{
+    EventCounters[id].Time += Now() - start;
+    EventCounters[id].Calls++;
+}
+
+#endif
+
+}
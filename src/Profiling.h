@@ -0,0 +1,78 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include "types.h"
+
+// host-time breakdown of the main loop, per subsystem
+// only compiled in when CORE_PROFILING_ENABLED is defined, as reading the
+// host clock on every slice is not free
+
+namespace Profiling
+{
+
+enum
+{
+    Prof_ARM9 = 0,
+    Prof_ARM7,
+    Prof_DMA9,
+    Prof_DMA7,
+    Prof_GPU3D,
+    Prof_Events,
+
+    Prof_MAX
+};
+
+struct Counter
+{
+    u64 Time; // nanoseconds
+    u64 Calls;
+};
+
+const char* GetName(int id);
+
+void Reset();
+
+// subsystem counters (Prof_*)
+const Counter& Get(int id);
+// scheduler event counters (NDS::Event_*), those are also counted in Prof_Events
+const Counter& GetEvent(int id);
+
+#ifdef CORE_PROFILING_ENABLED
+
+u64 Now();
+void Add(int id, u64 start);
+void AddEvent(int id, u64 start);
+
+#define PROFILE_START(var) u64 var = Profiling::Now()
+#define PROFILE_END(id, var) Profiling::Add(id, var)
+#define PROFILE_END_EVENT(id, var) Profiling::AddEvent(id, var)
+
+#else
+
+#define PROFILE_START(var)
+#define PROFILE_END(id, var)
+#define PROFILE_END_EVENT(id, var)
+
+#endif
+
+}
+
+#endif // PROFILING_H
@@ -0,0 +1,297 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "NDS.h"
+#include "Platform.h"
+#include "Savestate.h"
+#include "Rewind.h"
+
+
+namespace Rewind
+{
+
+// the newest state is kept as is, every older state is stored as the XOR
+// of itself and the state that follows it. those deltas are mostly zero,
+// so they are packed as runs of equal words followed by runs of XORed words:
+//   header: (number of equal words << 32) | number of XORed words
+//   XORed words
+// applying a delta to a state gives back the previous one.
+//
+// states are kept zero-padded to a common size, so that states of
+// different lengths can still be XORed together.
+
+bool Enabled;
+u32 Interval;
+u32 MaxStates;
+u64 MaxMemory;
+
+u64* Current;
+u64* Scratch;
+u32 StateSize; // in words
+bool HasCurrent;
+
+std::vector<u64>* Deltas;
+u32 DeltaStart, DeltaCount;
+u64 DeltaMemory;
+
+u32 FrameCount;
+
+
+bool Init()
+{
+    Current = nullptr;
+    Scratch = nullptr;
+    StateSize = 0;
+    HasCurrent = false;
+
+    Deltas = nullptr;
+    MaxStates = 0;
+    DeltaStart = 0;
+    DeltaCount = 0;
+    DeltaMemory = 0;
+
+    return true;
+}
+
+void DeInit()
+{
+    if (Current) delete[] Current;
+    if (Scratch) delete[] Scratch;
+    Current = nullptr;
+    Scratch = nullptr;
+    StateSize = 0;
+    HasCurrent = false;
+
+    if (Deltas) delete[] Deltas;
+    Deltas = nullptr;
+    MaxStates = 0;
+    DeltaStart = 0;
+    DeltaCount = 0;
+    DeltaMemory = 0;
+}
+
+void Reset()
+{
+    DeInit();
+
+    Enabled = Platform::GetConfigBool(Platform::Rewind_Enable);
+
+    int interval = Platform::GetConfigInt(Platform::Rewind_Interval);
+    if (interval < 1) interval = 1;
+    Interval = interval;
+
+    int length = Platform::GetConfigInt(Platform::Rewind_Length);
+    if (length < 1) length = 10;
+    MaxStates = (length * 60 + Interval - 1) / Interval;
+
+    int maxmem = Platform::GetConfigInt(Platform::Rewind_MaxMemory);
+    if (maxmem < 1) maxmem = 256;
+    MaxMemory = (u64)maxmem << 20;
+
+    FrameCount = 0;
+
+    if (Enabled)
+        Deltas = new std::vector<u64>[MaxStates];
+}
+
+
+void Grow(u32 len)
+{
+    // in words, rounded to 8 words, with some headroom to avoid growing every time
+    u32 size = (((len + 7) >> 3) + 0x2000) & ~7;
+
+    u64* cur = new u64[size];
+    u64* scratch = new u64[size];
+    memset(cur, 0, size*8);
+    memset(scratch, 0, size*8);
+
+    if (Current)
+    {
+        memcpy(cur, Current, StateSize*8);
+        delete[] Current;
+        delete[] Scratch;
+    }
+
+    Current = cur;
+    Scratch = scratch;
+    StateSize = size;
+}
+
+bool SaveState(u64* buf)
+{
+    Savestate* state = new Savestate(buf, StateSize*8, true);
+    NDS::DoSavestate(state);
+    bool error = state->Error;
+    u32 len = state->GetOffset();
+    delete state;
+
+    if (error) return false;
+
+    // clear the leftovers of the previous, possibly longer, state
+    memset((u8*)buf + len, 0, StateSize*8 - len);
+    return true;
+}
+
+void EncodeDelta(std::vector<u64>& out, u64* a, u64* b)
+{
+    out.clear();
+
+    u32 i = 0;
+    while (i < StateSize)
+    {
+        u32 start = i;
+
+        // skip equal blocks quickly, the tail is handled word by word
+        while (i + 8 <= StateSize)
+        {
+            u64 diff = 0;
+            for (int j = 0; j < 8; j++)
+                diff |= a[i+j] ^ b[i+j];
+            if (diff) break;
+            i += 8;
+        }
+        while (i < StateSize && a[i] == b[i]) i++;
+        u32 equal = i - start;
+
+        // lone equal words are cheaper to keep in the run than to split it
+        start = i;
+        while (i < StateSize && (a[i] != b[i] || (i+1 < StateSize && a[i+1] != b[i+1]))) i++;
+
+        out.push_back(((u64)equal << 32) | (i - start));
+        for (u32 j = start; j < i; j++)
+            out.push_back(a[j] ^ b[j]);
+    }
+}
+
+void ApplyDelta(u64* buf, std::vector<u64>& delta)
+{
+    u32 pos = 0;
+    size_t i = 0;
+    while (i < delta.size())
+    {
+        u64 header = delta[i++];
+        pos += header >> 32;
+
+        u32 len = header & 0xFFFFFFFF;
+        for (u32 j = 0; j < len; j++)
+            buf[pos++] ^= delta[i++];
+    }
+}
+
+void DropOldest()
+{
+    std::vector<u64>& delta = Deltas[DeltaStart];
+    DeltaMemory -= delta.capacity() * 8;
+    std::vector<u64>().swap(delta);
+
+    DeltaStart = (DeltaStart + 1) % MaxStates;
+    DeltaCount--;
+}
+
+void Push()
+{
+    if (!Scratch || !SaveState(Scratch))
+    {
+        Savestate* dry = new Savestate();
+        NDS::DoSavestate(dry);
+        u32 len = dry->GetOffset();
+        delete dry;
+
+        Grow(len);
+        if (!SaveState(Scratch))
+        {
+            printf("rewind: failed to save state\n");
+            return;
+        }
+    }
+
+    if (HasCurrent)
+    {
+        if (DeltaCount == MaxStates)
+            DropOldest();
+
+        std::vector<u64>& delta = Deltas[(DeltaStart + DeltaCount) % MaxStates];
+        DeltaMemory -= delta.capacity() * 8;
+        EncodeDelta(delta, Current, Scratch);
+        DeltaMemory += delta.capacity() * 8;
+        DeltaCount++;
+
+        while (DeltaCount > 0 && DeltaMemory > MaxMemory)
+            DropOldest();
+    }
+
+    u64* tmp = Current;
+    Current = Scratch;
+    Scratch = tmp;
+    HasCurrent = true;
+}
+
+void Frame()
+{
+    if (!Enabled) return;
+
+    FrameCount++;
+    if (FrameCount < Interval) return;
+
+    FrameCount = 0;
+    Push();
+}
+
+int StepBack(int frames)
+{
+    if (!Enabled || !HasCurrent) return 0;
+
+    // going back to the newest state covers the frames run since it was made
+    int rewound = FrameCount;
+    while (rewound < frames && DeltaCount > 0)
+    {
+        DeltaCount--;
+        std::vector<u64>& delta = Deltas[(DeltaStart + DeltaCount) % MaxStates];
+        ApplyDelta(Current, delta);
+        DeltaMemory -= delta.capacity() * 8;
+        std::vector<u64>().swap(delta);
+        rewound += Interval;
+    }
+
+    if (rewound == 0) return 0;
+
+    Savestate* state = new Savestate(Current, StateSize*8, false);
+    bool res = !state->Error && NDS::DoSavestate(state) && !state->Error;
+    delete state;
+
+    if (!res)
+    {
+        printf("rewind: failed to load state\n");
+        return 0;
+    }
+
+    FrameCount = 0;
+    return rewound;
+}
+
+int GetAvailableFrames()
+{
+    if (!Enabled || !HasCurrent) return 0;
+
+    return DeltaCount * Interval + FrameCount;
+}
+
+}
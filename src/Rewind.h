@@ -0,0 +1,47 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "types.h"
+
+// in-memory rewind buffer
+// the frontend calls Frame() after every emulated frame, a state is kept
+// every Rewind_Interval frames, up to Rewind_Length seconds back and
+// Rewind_MaxMemory MB of memory
+
+namespace Rewind
+{
+
+bool Init();
+void DeInit();
+void Reset();
+
+void Frame();
+
+// go back at least the given amount of frames, as far as the buffer allows
+// returns how many frames were actually rewound
+int StepBack(int frames);
+
+// how many frames back the buffer currently reaches
+int GetAvailableFrames();
+
+}
+
+#endif // REWIND_H
@@ -0,0 +1,128 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <stdio.h>
+#include "NDS.h"
+#include "GPU.h"
+#include "GPU3D.h"
+#include "SPU.h"
+#include "Platform.h"
+#include "Savestate.h"
+#include "RunAhead.h"
+
+
+namespace RunAhead
+{
+
+int Frames;
+
+u8* State;
+u32 StateSize;
+
+
+bool Init()
+{
+    State = nullptr;
+    StateSize = 0;
+
+    return true;
+}
+
+void DeInit()
+{
+    if (State) delete[] State;
+    State = nullptr;
+    StateSize = 0;
+}
+
+void Reset()
+{
+    Frames = Platform::GetConfigInt(Platform::RunAhead_Frames);
+    if (Frames < 0) Frames = 0;
+    else if (Frames > 8) Frames = 8;
+}
+
+
+bool SaveState()
+{
+    if (State)
+    {
+        Savestate* state = new Savestate(State, StateSize, true);
+        NDS::DoSavestate(state);
+        bool error = state->Error;
+        delete state;
+
+        if (!error) return true;
+    }
+
+    // buffer missing or too small
+    Savestate* dry = new Savestate();
+    NDS::DoSavestate(dry);
+    u32 len = dry->GetOffset();
+    delete dry;
+
+    if (State) delete[] State;
+    StateSize = len + 0x10000;
+    State = new u8[StateSize];
+
+    Savestate* state = new Savestate(State, StateSize, true);
+    NDS::DoSavestate(state);
+    bool error = state->Error;
+    delete state;
+
+    if (error) printf("run-ahead: failed to save state\n");
+    return !error;
+}
+
+void LoadState()
+{
+    Savestate* state = new Savestate(State, StateSize, false);
+    if (!state->Error)
+        NDS::DoSavestate(state);
+    delete state;
+}
+
+u32 RunFrame()
+{
+    u32 nlines = NDS::RunFrame();
+    if (Frames == 0)
+        return nlines;
+
+    if (!SaveState())
+        return nlines;
+
+    // only the last frame is shown
+    // its 3D scene is rendered during the frame before it
+    SPU::SetOutputEnabled(false);
+    for (int i = 1; i <= Frames; i++)
+    {
+        GPU::SetRenderSkip(i < Frames, i != Frames-1);
+        NDS::RunFrame();
+    }
+    GPU::SetRenderSkip(false, false);
+    SPU::SetOutputEnabled(true);
+
+    LoadState();
+
+    // the restored frame needs the 3D scene of its own timeline
+    GPU3D::RerenderFrame();
+
+    return nlines;
+}
+
+}
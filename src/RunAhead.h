@@ -0,0 +1,40 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef RUNAHEAD_H
+#define RUNAHEAD_H
+
+#include "types.h"
+
+// run-ahead: every frame, the console is run RunAhead_Frames further
+// with the same input, that frame is shown, then the state is restored
+// this hides as many frames of the game's own input lag
+
+namespace RunAhead
+{
+
+bool Init();
+void DeInit();
+void Reset();
+
+// to be used instead of NDS::RunFrame()
+u32 RunFrame();
+
+}
+
+#endif // RUNAHEAD_H
@@ -83,6 +83,7 @@ u8 MasterVolume;
 u16 Bias;
 bool ApplyBias;
 bool Degrade10Bit;
+bool OutputEnabled;
 
 Channel* Channels[16];
 CaptureUnit* Capture[2];
@@ -101,6 +102,7 @@ bool Init()
     InterpType = 0;
     ApplyBias = true;
     Degrade10Bit = false;
+    OutputEnabled = true;
 
     // generate interpolation tables
     // values are 1:1:14 fixed-point
@@ -204,6 +206,11 @@ void SetDegrade10Bit(bool enable)
     Degrade10Bit = enable;
 }
 
+void SetOutputEnabled(bool enable)
+{
+    OutputEnabled = enable;
+}
+
 
 Channel::Channel(u32 num)
 {
@@ -850,6 +857,12 @@ void Mix(u32 dummy)
 
 void TransferOutput()
 {
+    if (!OutputEnabled)
+    {
+        OutputBackbufferWritePosition = 0;
+        return;
+    }
+
     Platform::Mutex_Lock(AudioLock);
     for (u32 i = 0; i < OutputBackbufferWritePosition; i += 2)
     {
@@ -37,6 +37,8 @@ void SetInterpolation(int type);
 void SetBias(u16 bias);
 void SetDegrade10Bit(bool enable);
 void SetApplyBias(bool enable);
+// when disabled, the mixed samples are thrown away (run-ahead)
+void SetOutputEnabled(bool enable);
 
 void Mix(u32 dummy);
 
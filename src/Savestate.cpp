@@ -17,17 +17,10 @@
 */
 
 #include <stdio.h>
+#include <string.h>
 #include "Savestate.h"
 #include "Platform.h"
 
-#ifdef __LIBRETRO__
-#define fclose(stream) memstream_close(stream)
-#define fread(data, len, count, stream) memstream_read(stream, data, len)
-#define fwrite(data, len, count, stream) memstream_write(stream, data, len)
-#define fseek(stream, offset, mask) memstream_seek(stream, offset, mask)
-#define ftell(stream) memstream_pos(stream)
-#endif
-
 /*
     Savestate format
 
@@ -51,76 +44,101 @@
     * different minor means adjustments may have to be made
 */
 
-#ifdef __LIBRETRO__
-Savestate::Savestate(void *data, size_t size, bool save)
-#else
 Savestate::Savestate(const char* filename, bool save)
-#endif
 {
-    const char* magic = "MELN";
-
     Error = false;
+    Saving = save;
+    Buffer = nullptr;
+    BufferSize = 0;
+    BufferPos = 0;
+    BufferLen = 0;
+    DryRun = false;
 
     if (save)
     {
-        Saving = true;
-#ifdef __LIBRETRO__
-        memstream_set_buffer((uint8_t*)data, size);
-        file = memstream_open(true);
-        if (file == NULL)
+        file = Platform::OpenFile(filename, "wb");
+        if (!file)
         {
-            printf("unable to create memstream for savestate\n");
+            printf("savestate: file %s doesn't exist\n", filename);
             Error = true;
             return;
         }
-#else
-        file = Platform::OpenFile(filename, "wb");
+    }
+    else
+    {
+        file = Platform::OpenFile(filename, "rb");
         if (!file)
         {
-            printf("savestate: file %s doesn't exist\n", filename.c_str());
+            printf("savestate: file %s doesn't exist\n", filename);
             Error = true;
             return;
         }
-#endif
+    }
+
+    Init(save);
+}
+
+Savestate::Savestate(void* data, u32 size, bool save)
+{
+    Error = false;
+    Saving = save;
+    file = nullptr;
+    Buffer = (u8*)data;
+    BufferSize = size;
+    BufferPos = 0;
+    BufferLen = save ? 0 : size;
+    DryRun = false;
+
+    if (!Buffer)
+    {
+        printf("savestate: no buffer\n");
+        Error = true;
+        return;
+    }
+
+    Init(save);
+}
+
+Savestate::Savestate()
+{
+    Error = false;
+    file = nullptr;
+    Buffer = nullptr;
+    BufferSize = 0;
+    BufferPos = 0;
+    BufferLen = 0;
+    DryRun = true;
+
+    Init(true);
+}
+
+void Savestate::Init(bool save)
+{
+    const char* magic = "MELN";
+
+    Incremental = false;
+
+    if (save)
+    {
+        Saving = true;
 
         VersionMajor = SAVESTATE_MAJOR;
         VersionMinor = SAVESTATE_MINOR;
 
-        fwrite(magic, 4, 1, file);
-        fwrite(&VersionMajor, 2, 1, file);
-        fwrite(&VersionMinor, 2, 1, file);
-        fseek(file, 8, SEEK_CUR); // length to be fixed later
+        Write(magic, 4);
+        Write(&VersionMajor, 2);
+        Write(&VersionMinor, 2);
+        WriteZero(8); // length to be fixed later
     }
     else
     {
         Saving = false;
-#ifdef __LIBRETRO__
-        memstream_set_buffer((uint8_t*)data, size);
-        file = memstream_open(false);
-        if (file == NULL)
-        {
-            printf("unable to create memstream for savestate\n");
-            Error = true;
-            return;
-        }
-#else
-        file = Platform::OpenFile(filename, "rb");
-        if (!file)
-        {
-            printf("savestate: file %s doesn't exist\n", filename.c_str());
-            Error = true;
-            return;
-        }
-#endif
 
-        u32 len;
-        fseek(file, 0, SEEK_END);
-        len = (u32)ftell(file);
-        fseek(file, 0, SEEK_SET);
+        u32 len = Length();
 
         u32 buf = 0;
 
-        fread(&buf, 4, 1, file);
+        Read(&buf, 4);
         if (buf != ((u32*)magic)[0])
         {
             printf("savestate: invalid magic %08X\n", buf);
@@ -131,7 +149,7 @@ Savestate::Savestate(const char* filename, bool save)
         VersionMajor = 0;
         VersionMinor = 0;
 
-        fread(&VersionMajor, 2, 1, file);
+        Read(&VersionMajor, 2);
         if (VersionMajor != SAVESTATE_MAJOR)
         {
             printf("savestate: bad version major %d, expecting %d\n", VersionMajor, SAVESTATE_MAJOR);
@@ -139,7 +157,7 @@ Savestate::Savestate(const char* filename, bool save)
             return;
         }
 
-        fread(&VersionMinor, 2, 1, file);
+        Read(&VersionMinor, 2);
         if (VersionMinor > SAVESTATE_MINOR)
         {
             printf("savestate: state from the future, %d > %d\n", VersionMinor, SAVESTATE_MINOR);
@@ -148,15 +166,18 @@ Savestate::Savestate(const char* filename, bool save)
         }
 
         buf = 0;
-        fread(&buf, 4, 1, file);
-        if (buf != len)
+        Read(&buf, 4);
+        if (file ? (buf != len) : (buf > len))
         {
             printf("savestate: bad length %d\n", buf);
             Error = true;
             return;
         }
 
-        fseek(file, 4, SEEK_CUR);
+        // a memory buffer may be larger than the state it holds
+        if (!file) BufferLen = buf;
+
+        Skip(4);
     }
 
     CurSection = -1;
@@ -164,30 +185,127 @@ Savestate::Savestate(const char* filename, bool save)
 
 Savestate::~Savestate()
 {
-    if (Error) return;
+    if (Error)
+    {
+        if (file) fclose(file);
+        return;
+    }
 
     if (Saving)
     {
         if (CurSection != 0xFFFFFFFF)
         {
-            u32 pos = (u32)ftell(file);
-            fseek(file, CurSection+4, SEEK_SET);
+            u32 pos = Tell();
+            Seek(CurSection+4);
 
             u32 len = pos - CurSection;
-            fwrite(&len, 4, 1, file);
+            Write(&len, 4);
 
-            fseek(file, pos, SEEK_SET);
+            Seek(pos);
         }
 
-        fseek(file, 0, SEEK_END);
-        u32 len = (u32)ftell(file);
-        fseek(file, 8, SEEK_SET);
-        fwrite(&len, 4, 1, file);
+        u32 len = Length();
+        Seek(8);
+        Write(&len, 4);
+        Seek(len);
     }
 
     if (file) fclose(file);
 }
 
+void Savestate::Write(const void* data, u32 len)
+{
+    if (file)
+    {
+        fwrite(data, len, 1, file);
+        return;
+    }
+
+    if (!DryRun)
+    {
+        if ((u64)BufferPos + len > BufferSize)
+        {
+            printf("savestate: buffer too small (%d bytes)\n", BufferSize);
+            Error = true;
+            return;
+        }
+
+        memcpy(&Buffer[BufferPos], data, len);
+    }
+
+    BufferPos += len;
+    if (BufferPos > BufferLen) BufferLen = BufferPos;
+}
+
+void Savestate::Read(void* data, u32 len)
+{
+    if (file)
+    {
+        fread(data, len, 1, file);
+        return;
+    }
+
+    // like fread(), reading past the end leaves the destination alone
+    if ((u64)BufferPos + len > BufferLen)
+    {
+        BufferPos = BufferLen;
+        return;
+    }
+
+    memcpy(data, &Buffer[BufferPos], len);
+    BufferPos += len;
+}
+
+void Savestate::WriteZero(u32 len)
+{
+    const u8 zero[16] = {0};
+
+    while (len > 0)
+    {
+        u32 chunk = len > 16 ? 16 : len;
+        Write(zero, chunk);
+        len -= chunk;
+    }
+}
+
+void Savestate::Seek(u32 pos)
+{
+    if (file)
+        fseek(file, pos, SEEK_SET);
+    else
+        BufferPos = pos;
+}
+
+void Savestate::Skip(u32 len)
+{
+    if (file)
+        fseek(file, len, SEEK_CUR);
+    else
+        BufferPos += len;
+}
+
+u32 Savestate::Tell()
+{
+    if (file)
+        return (u32)ftell(file);
+    else
+        return BufferPos;
+}
+
+u32 Savestate::Length()
+{
+    if (file)
+    {
+        long pos = ftell(file);
+        fseek(file, 0, SEEK_END);
+        u32 len = (u32)ftell(file);
+        fseek(file, pos, SEEK_SET);
+        return len;
+    }
+    else
+        return BufferLen;
+}
+
 void Savestate::Section(const char* magic)
 {
     if (Error) return;
@@ -196,29 +314,29 @@ void Savestate::Section(const char* magic)
     {
         if (CurSection != 0xFFFFFFFF)
         {
-            u32 pos = (u32)ftell(file);
-            fseek(file, CurSection+4, SEEK_SET);
+            u32 pos = Tell();
+            Seek(CurSection+4);
 
             u32 len = pos - CurSection;
-            fwrite(&len, 4, 1, file);
+            Write(&len, 4);
 
-            fseek(file, pos, SEEK_SET);
+            Seek(pos);
         }
 
-        CurSection = (u32)ftell(file);
+        CurSection = Tell();
 
-        fwrite(magic, 4, 1, file);
-        fseek(file, 12, SEEK_CUR);
+        Write(magic, 4);
+        WriteZero(12);
     }
     else
     {
-        fseek(file, 0x10, SEEK_SET);
+        Seek(0x10);
 
         for (;;)
         {
             u32 buf = 0;
 
-            fread(&buf, 4, 1, file);
+            Read(&buf, 4);
             if (buf != ((u32*)magic)[0])
             {
                 if (buf == 0)
@@ -228,12 +346,12 @@ void Savestate::Section(const char* magic)
                 }
 
                 buf = 0;
-                fread(&buf, 4, 1, file);
-                fseek(file, buf-8, SEEK_CUR);
+                Read(&buf, 4);
+                Skip(buf-8);
                 continue;
             }
 
-            fseek(file, 12, SEEK_CUR);
+            Skip(12);
             break;
         }
     }
@@ -245,11 +363,11 @@ void Savestate::Var8(u8* var)
 
     if (Saving)
     {
-        fwrite(var, 1, 1, file);
+        Write(var, 1);
     }
     else
     {
-        fread(var, 1, 1, file);
+        Read(var, 1);
     }
 }
 
@@ -259,11 +377,11 @@ void Savestate::Var16(u16* var)
 
     if (Saving)
     {
-        fwrite(var, 2, 1, file);
+        Write(var, 2);
     }
     else
     {
-        fread(var, 2, 1, file);
+        Read(var, 2);
     }
 }
 
@@ -273,11 +391,11 @@ void Savestate::Var32(u32* var)
 
     if (Saving)
     {
-        fwrite(var, 4, 1, file);
+        Write(var, 4);
     }
     else
     {
-        fread(var, 4, 1, file);
+        Read(var, 4);
     }
 }
 
@@ -287,11 +405,11 @@ void Savestate::Var64(u64* var)
 
     if (Saving)
     {
-        fwrite(var, 8, 1, file);
+        Write(var, 8);
     }
     else
     {
-        fread(var, 8, 1, file);
+        Read(var, 8);
     }
 }
 
@@ -305,7 +423,7 @@ void Savestate::Bool32(bool* var)
     }
     else
     {
-        u32 val;
+        u32 val = 0;
         Var32(&val);
         *var = val != 0;
     }
@@ -317,10 +435,10 @@ void Savestate::VarArray(void* data, u32 len)
 
     if (Saving)
     {
-        fwrite(data, len, 1, file);
+        Write(data, len);
     }
     else
     {
-        fread(data, len, 1, file);
+        Read(data, len);
     }
 }
@@ -22,22 +22,23 @@
 #include <string>
 #include <stdio.h>
 #include "types.h"
+#include "NonStupidBitfield.h"
 
-#define SAVESTATE_MAJOR 9
+#define SAVESTATE_MAJOR 10
 #define SAVESTATE_MINOR 0
 
-#ifdef __LIBRETRO__
-#include <streams/memory_stream.h>
-#endif
-
 class Savestate
 {
 public:
-#ifdef __LIBRETRO__
-    Savestate(void *data, size_t size, bool save);
-#else
     Savestate(const char* filename, bool save);
-#endif
+
+    // memory-backed savestate, the buffer is owned by the caller
+    Savestate(void* data, u32 size, bool save);
+
+    // dry run: saves nothing, only keeps track of how large the state would be
+    // (use GetOffset() once done)
+    Savestate();
+
     ~Savestate();
 
     bool Error;
@@ -48,6 +49,11 @@ public:
 
     u32 CurSection;
 
+    // incremental state: memory only holds the pages written since the last
+    // full state was saved or loaded, and must be loaded on top of that one
+    // set before saving, filled in when loading
+    bool Incremental;
+
     void Section(const char* magic);
 
     void Var8(u8* var);
@@ -59,6 +65,32 @@ public:
 
     void VarArray(void* data, u32 len);
 
+    // memory with write tracking: a full state stores all of it and resets
+    // the tracking, an incremental one stores the dirty pages and their bits
+    template <u32 Size>
+    void VarArrayDirty(void* data, u32 len, NonStupidBitField<Size>& dirty, u32 granularity)
+    {
+        if (!Incremental)
+        {
+            VarArray(data, len);
+            dirty.Clear();
+            return;
+        }
+
+        NonStupidBitField<Size> pages;
+        if (Saving) pages = dirty;
+        VarArray(pages.Data, sizeof(pages.Data));
+
+        for (auto it = pages.Begin(); it != pages.End(); it++)
+        {
+            if (*it * granularity >= len) break;
+            VarArray((u8*)data + *it * granularity, granularity);
+        }
+
+        // the pages now differ from the base state
+        if (!Saving) dirty |= pages;
+    }
+
     bool IsAtleastVersion(u32 major, u32 minor)
     {
         if (VersionMajor > major) return true;
@@ -66,19 +98,27 @@ public:
         return false;
     }
 
-#ifdef __LIBRETRO__
-    uint64_t GetOffset()
-    {
-        return memstream_pos(file);
-    }
-#endif
+    u32 GetOffset() { return Tell(); }
 
 private:
-#ifdef __LIBRETRO__
-    memstream_t* file;
-#else
     FILE* file;
-#endif
+
+    // memory backend, used when file is null
+    u8* Buffer;
+    u32 BufferSize;
+    u32 BufferPos;
+    u32 BufferLen;
+    bool DryRun;
+
+    void Init(bool save);
+
+    void Write(const void* data, u32 len);
+    void Read(void* data, u32 len);
+    void WriteZero(u32 len);
+    void Seek(u32 pos);
+    void Skip(u32 len);
+    u32 Tell();
+    u32 Length();
 };
 
 #endif // SAVESTATE_H
@@ -0,0 +1,278 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "Platform.h"
+#include "Config.h"
+
+// minimal Platform implementation for the benchmark runner
+// no frontend, no networking, save files are never written back
+
+
+namespace Platform
+{
+
+void Init(int argc, char** argv)
+{
+}
+
+void DeInit()
+{
+}
+
+
+void StopEmu()
+{
+}
+
+
+int GetConfigInt(ConfigEntry entry)
+{
+    switch (entry)
+    {
+#ifdef JIT_ENABLED
+    case JIT_MaxBlockSize: return Config::JIT_MaxBlockSize;
+#endif
+
+    case AudioBitrate: return 0;
+
+    case Rewind_Length: return Config::RewindLength;
+
+    case RunAhead_Frames: return Config::RunAheadFrames;
+    }
+
+    return 0;
+}
+
+bool GetConfigBool(ConfigEntry entry)
+{
+    switch (entry)
+    {
+#ifdef JIT_ENABLED
+    case JIT_Enable: return Config::JIT_Enable;
+    case JIT_LiteralOptimizations: return Config::JIT_LiteralOptimisations;
+    case JIT_BranchOptimizations: return Config::JIT_BranchOptimisations;
+    case JIT_FastMemory: return Config::JIT_FastMemory;
+    case JIT_AsyncCompilation: return Config::JIT_AsyncCompilation;
+    case JIT_TieredCompilation: return Config::JIT_TieredCompilation;
+#endif
+
+    case ExternalBIOSEnable: return Config::ExternalBIOSEnable;
+
+    case Rewind_Enable: return Config::RewindLength > 0;
+    }
+
+    return false;
+}
+
+std::string GetConfigString(ConfigEntry entry)
+{
+    switch (entry)
+    {
+    case BIOS9Path: return Config::BIOS9Path;
+    case BIOS7Path: return Config::BIOS7Path;
+    case FirmwarePath: return Config::FirmwarePath;
+
+    case DSi_BIOS9Path: return Config::DSiBIOS9Path;
+    case DSi_BIOS7Path: return Config::DSiBIOS7Path;
+    case DSi_FirmwarePath: return Config::DSiFirmwarePath;
+    case DSi_NANDPath: return Config::DSiNANDPath;
+    }
+
+    return "";
+}
+
+bool GetConfigArray(ConfigEntry entry, void* data)
+{
+    return false;
+}
+
+
+FILE* OpenFile(std::string path, std::string mode, bool mustexist)
+{
+    if (mustexist)
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return nullptr;
+        fclose(f);
+    }
+
+    return fopen(path.c_str(), mode.c_str());
+}
+
+FILE* OpenLocalFile(std::string path, std::string mode)
+{
+    return OpenFile(path, mode, mode[0] != 'w');
+}
+
+
+struct Thread
+{
+    std::thread Impl;
+};
+
+Thread* Thread_Create(std::function<void()> func)
+{
+    Thread* t = new Thread;
+    t->Impl = std::thread(func);
+    return t;
+}
+
+void Thread_Free(Thread* thread)
+{
+    if (thread->Impl.joinable())
+        thread->Impl.detach();
+    delete thread;
+}
+
+void Thread_Wait(Thread* thread)
+{
+    if (thread->Impl.joinable())
+        thread->Impl.join();
+}
+
+struct Semaphore
+{
+    std::mutex Lock;
+    std::condition_variable Cond;
+    int Count = 0;
+};
+
+Semaphore* Semaphore_Create()
+{
+    return new Semaphore;
+}
+
+void Semaphore_Free(Semaphore* sema)
+{
+    delete sema;
+}
+
+void Semaphore_Reset(Semaphore* sema)
+{
+    std::lock_guard<std::mutex> lock(sema->Lock);
+    sema->Count = 0;
+}
+
+void Semaphore_Wait(Semaphore* sema)
+{
+    std::unique_lock<std::mutex> lock(sema->Lock);
+    sema->Cond.wait(lock, [sema]{ return sema->Count > 0; });
+    sema->Count--;
+}
+
+void Semaphore_Post(Semaphore* sema, int count)
+{
+    {
+        std::lock_guard<std::mutex> lock(sema->Lock);
+        sema->Count += count;
+    }
+    sema->Cond.notify_all();
+}
+
+struct Mutex
+{
+    std::mutex Impl;
+};
+
+Mutex* Mutex_Create()
+{
+    return new Mutex;
+}
+
+void Mutex_Free(Mutex* mutex)
+{
+    delete mutex;
+}
+
+void Mutex_Lock(Mutex* mutex)
+{
+    mutex->Impl.lock();
+}
+
+void Mutex_Unlock(Mutex* mutex)
+{
+    mutex->Impl.unlock();
+}
+
+bool Mutex_TryLock(Mutex* mutex)
+{
+    return mutex->Impl.try_lock();
+}
+
+
+void WriteNDSSave(const u8* savedata, u32 savelen, u32 writeoffset, u32 writelen)
+{
+}
+
+void WriteGBASave(const u8* savedata, u32 savelen, u32 writeoffset, u32 writelen)
+{
+}
+
+
+bool MP_Init()
+{
+    return false;
+}
+
+void MP_DeInit()
+{
+}
+
+int MP_SendPacket(u8* data, int len)
+{
+    return len;
+}
+
+int MP_RecvPacket(u8* data, bool block)
+{
+    return 0;
+}
+
+bool LAN_Init()
+{
+    return false;
+}
+
+void LAN_DeInit()
+{
+}
+
+int LAN_SendPacket(u8* data, int len)
+{
+    return len;
+}
+
+int LAN_RecvPacket(u8* data)
+{
+    return 0;
+}
+
+void Sleep(u64 usecs)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(usecs));
+}
+
+}
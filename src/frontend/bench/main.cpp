@@ -0,0 +1,518 @@
+/*
+    Copyright 2016-2022 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// headless benchmark runner
+// runs the core as fast as possible with no frame limiting, no audio output
+// and no presentation, and reports how long it took
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "NDS.h"
+#include "GPU.h"
+#include "SPU.h"
+#include "Platform.h"
+#include "Profiling.h"
+#include "Rewind.h"
+#include "RunAhead.h"
+#include "Config.h"
+#ifdef JIT_ENABLED
+#include "ARMJIT.h"
+#endif
+
+
+namespace Config
+{
+
+int ConsoleType = 0;
+bool DirectBoot = true;
+int RewindLength = 0;
+int RunAheadFrames = 0;
+
+bool JIT_Enable = false;
+int JIT_MaxBlockSize = 32;
+bool JIT_LiteralOptimisations = true;
+bool JIT_BranchOptimisations = true;
+bool JIT_FastMemory = true;
+bool JIT_AsyncCompilation = false;
+bool JIT_TieredCompilation = false;
+
+bool ExternalBIOSEnable = false;
+std::string BIOS9Path;
+std::string BIOS7Path;
+std::string FirmwarePath;
+
+std::string DSiBIOS9Path;
+std::string DSiBIOS7Path;
+std::string DSiFirmwarePath;
+std::string DSiNANDPath;
+
+bool Threaded3D = false;
+
+}
+
+
+// emulated refresh rate: 33513982 Hz / (6 * 355 * 263)
+const double NativeFPS = 59.8261;
+
+const char* EventName(int id)
+{
+    switch (id)
+    {
+    case NDS::Event_LCD: return "LCD";
+    case NDS::Event_SPU: return "SPU";
+    case NDS::Event_Wifi: return "Wifi";
+    case NDS::Event_DisplayFIFO: return "DisplayFIFO";
+    case NDS::Event_ROMTransfer: return "ROMTransfer";
+    case NDS::Event_ROMSPITransfer: return "ROMSPITransfer";
+    case NDS::Event_SPITransfer: return "SPITransfer";
+    case NDS::Event_Div: return "Div";
+    case NDS::Event_Sqrt: return "Sqrt";
+    case NDS::Event_Timer9: return "Timer9";
+    case NDS::Event_Timer7: return "Timer7";
+    case NDS::Event_DSi_SDMMCTransfer: return "DSi_SDMMCTransfer";
+    case NDS::Event_DSi_SDIOTransfer: return "DSi_SDIOTransfer";
+    case NDS::Event_DSi_NWifi: return "DSi_NWifi";
+    case NDS::Event_DSi_CamIRQ: return "DSi_CamIRQ";
+    case NDS::Event_DSi_CamTransfer: return "DSi_CamTransfer";
+    case NDS::Event_DSi_DSP: return "DSi_DSP";
+    }
+
+    return "?";
+}
+
+void PrintUsage(const char* self)
+{
+    printf("usage: %s [options] [rom.nds]\n", self);
+    printf("\n");
+    printf("  -n, --frames <n>       number of frames to measure (default: 3600)\n");
+    printf("  -w, --warmup <n>       frames to run before measuring (default: 60)\n");
+    printf("      --idle-loop        run a built-in cartridge which only idles, the ARM9 in a\n");
+    printf("                         THUMB 'b .' loop and the ARM7 in an ARM one (no ROM needed)\n");
+    printf("      --dsi              emulate a DSi (requires DSi BIOS, firmware and NAND)\n");
+    printf("      --firmware-boot    boot through the firmware instead of direct boot\n");
+    printf("      --rewind <n>       keep a rewind buffer of n seconds, updated every frame\n");
+    printf("      --run-ahead <n>    run n frames ahead every frame (0-8)\n");
+#ifdef JIT_ENABLED
+    printf("      --jit              enable the JIT recompiler\n");
+    printf("      --jit-block <n>    maximum JIT block size (default: 32)\n");
+    printf("      --no-fastmem       disable JIT fast memory\n");
+    printf("      --jit-async        compile JIT blocks on a separate thread\n");
+    printf("      --jit-tiered       recompile hot JIT blocks as longer traces\n");
+    printf("      --jit-stats <path> write the JIT statistics of every measured frame (CSV)\n");
+#endif
+    printf("      --threaded-3d      use the threaded software 3D renderer\n");
+    printf("      --bios9 <path>     DS ARM9 BIOS (enables external BIOS)\n");
+    printf("      --bios7 <path>     DS ARM7 BIOS\n");
+    printf("      --firmware <path>  DS firmware\n");
+    printf("      --dsi-bios9 <path> DSi ARM9 BIOS\n");
+    printf("      --dsi-bios7 <path> DSi ARM7 BIOS\n");
+    printf("      --dsi-firmware <path>\n");
+    printf("      --dsi-nand <path>\n");
+    printf("      --frame-log <path> write the host time of every measured frame (in ms)\n");
+}
+
+bool LoadFile(const char* path, u8** data, u32* len)
+{
+    FILE* f = Platform::OpenFile(path, "rb", true);
+    if (!f) return false;
+
+    fseek(f, 0, SEEK_END);
+    long flen = ftell(f);
+    if (flen <= 0 || flen > 0x40000000)
+    {
+        fclose(f);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_SET);
+    *data = new u8[flen];
+    if (fread(*data, (size_t)flen, 1, f) != 1)
+    {
+        fclose(f);
+        delete[] *data;
+        return false;
+    }
+
+    fclose(f);
+    *len = (u32)flen;
+    return true;
+}
+
+// a homebrew cartridge which does nothing but spin in place
+// measures how well idle loops are skipped, without needing a ROM
+void BuildIdleLoopROM(u8** data, u32* len)
+{
+    // large enough to hold the banner, which is read from offset 0 here
+    const u32 romlen = 0x4000;
+    u8* rom = new u8[romlen];
+    memset(rom, 0, romlen);
+
+    memcpy(&rom[0x0C], "####", 4);        // game code, marks it as homebrew
+    *(u32*)&rom[0x20] = 0x200;            // ARM9 ROM offset
+    *(u32*)&rom[0x24] = 0x02000000;       // ARM9 entry point
+    *(u32*)&rom[0x28] = 0x02000000;       // ARM9 RAM address
+    *(u32*)&rom[0x2C] = 0x10;             // ARM9 size
+    *(u32*)&rom[0x30] = 0x300;            // ARM7 ROM offset
+    *(u32*)&rom[0x34] = 0x02380000;       // ARM7 entry point
+    *(u32*)&rom[0x38] = 0x02380000;       // ARM7 RAM address
+    *(u32*)&rom[0x3C] = 0x4;              // ARM7 size
+    *(u32*)&rom[0x80] = romlen;
+    *(u32*)&rom[0x84] = 0x4000;
+
+    *(u32*)&rom[0x200] = 0xE28F0001;      // add r0, pc, #1
+    *(u32*)&rom[0x204] = 0xE12FFF10;      // bx r0
+    *(u16*)&rom[0x208] = 0xE7FE;          // b . (THUMB)
+
+    *(u32*)&rom[0x300] = 0xEAFFFFFE;      // b .
+
+    *data = rom;
+    *len = romlen;
+}
+
+// drain the audio output, so that the SPU behaves as it would with a frontend attached
+void DrainAudio()
+{
+    s16 buf[1024 * 2];
+    while (SPU::ReadOutput(buf, 1024) > 0);
+}
+
+int main(int argc, char** argv)
+{
+    u32 numframes = 3600;
+    u32 warmup = 60;
+    const char* rompath = nullptr;
+    const char* framelogpath = nullptr;
+    const char* jitstatspath = nullptr;
+    bool idleloop = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasval = (i+1) < argc;
+
+        if ((arg == "-n" || arg == "--frames") && hasval)
+            numframes = strtoul(argv[++i], nullptr, 0);
+        else if ((arg == "-w" || arg == "--warmup") && hasval)
+            warmup = strtoul(argv[++i], nullptr, 0);
+        else if (arg == "--idle-loop")
+            idleloop = true;
+        else if (arg == "--dsi")
+            Config::ConsoleType = 1;
+        else if (arg == "--firmware-boot")
+            Config::DirectBoot = false;
+        else if (arg == "--rewind" && hasval)
+            Config::RewindLength = strtol(argv[++i], nullptr, 0);
+        else if (arg == "--run-ahead" && hasval)
+            Config::RunAheadFrames = strtol(argv[++i], nullptr, 0);
+#ifdef JIT_ENABLED
+        else if (arg == "--jit")
+            Config::JIT_Enable = true;
+        else if (arg == "--jit-block" && hasval)
+            Config::JIT_MaxBlockSize = std::clamp((int)strtol(argv[++i], nullptr, 0), 1, 32);
+        else if (arg == "--no-fastmem")
+            Config::JIT_FastMemory = false;
+        else if (arg == "--jit-async")
+            Config::JIT_AsyncCompilation = true;
+        else if (arg == "--jit-tiered")
+            Config::JIT_TieredCompilation = true;
+        else if (arg == "--jit-stats" && hasval)
+            jitstatspath = argv[++i];
+#endif
+        else if (arg == "--threaded-3d")
+            Config::Threaded3D = true;
+        else if (arg == "--bios9" && hasval)
+        {
+            Config::BIOS9Path = argv[++i];
+            Config::ExternalBIOSEnable = true;
+        }
+        else if (arg == "--bios7" && hasval)
+            Config::BIOS7Path = argv[++i];
+        else if (arg == "--firmware" && hasval)
+            Config::FirmwarePath = argv[++i];
+        else if (arg == "--dsi-bios9" && hasval)
+            Config::DSiBIOS9Path = argv[++i];
+        else if (arg == "--dsi-bios7" && hasval)
+            Config::DSiBIOS7Path = argv[++i];
+        else if (arg == "--dsi-firmware" && hasval)
+            Config::DSiFirmwarePath = argv[++i];
+        else if (arg == "--dsi-nand" && hasval)
+            Config::DSiNANDPath = argv[++i];
+        else if (arg == "--frame-log" && hasval)
+            framelogpath = argv[++i];
+        else if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else if (arg[0] != '-' && !rompath)
+            rompath = argv[i];
+        else
+        {
+            printf("unknown or incomplete option: %s\n\n", argv[i]);
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (idleloop && (rompath || Config::ConsoleType != 0))
+    {
+        printf("--idle-loop brings its own cartridge and runs in DS mode\n\n");
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (!rompath && !idleloop && Config::ConsoleType == 0)
+    {
+        printf("a ROM is required in DS mode\n\n");
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Platform::Init(argc, argv);
+
+    if (!NDS::Init())
+    {
+        printf("failed to initialize the core\n");
+        return 1;
+    }
+
+    GPU::RenderSettings videosettings;
+    videosettings.Soft_Threaded = Config::Threaded3D;
+    videosettings.GL_ScaleFactor = 1;
+    videosettings.GL_BetterPolygons = false;
+
+    GPU::InitRenderer(0);
+    GPU::SetRenderSettings(0, videosettings);
+
+    NDS::SetConsoleType(Config::ConsoleType);
+
+    if (rompath || idleloop)
+    {
+        u8* romdata;
+        u32 romlen;
+        if (idleloop)
+            BuildIdleLoopROM(&romdata, &romlen);
+        else if (!LoadFile(rompath, &romdata, &romlen))
+        {
+            printf("failed to read ROM %s\n", rompath);
+            return 1;
+        }
+
+        NDS::EjectCart();
+        NDS::Reset();
+
+        bool res = NDS::LoadCart(romdata, romlen, nullptr, 0);
+        delete[] romdata;
+        if (!res)
+        {
+            printf("failed to load ROM %s\n", rompath ? rompath : "(idle loop)");
+            return 1;
+        }
+
+        if (Config::DirectBoot || NDS::NeedsDirectBoot())
+        {
+            std::string romname = rompath ? rompath : "idleloop.nds";
+            size_t sep = romname.find_last_of("/\\");
+            if (sep != std::string::npos)
+                romname = romname.substr(sep+1);
+
+            NDS::SetupDirectBoot(romname);
+        }
+    }
+    else
+    {
+        // DSi: boot the NAND menu
+        NDS::Reset();
+    }
+
+    NDS::Start();
+
+    for (u32 i = 0; i < warmup; i++)
+    {
+        RunAhead::RunFrame();
+        Rewind::Frame();
+        DrainAudio();
+    }
+
+    std::vector<double> frametimes;
+    frametimes.reserve(numframes);
+
+    Profiling::Reset();
+#ifdef JIT_ENABLED
+    ARMJIT::ResetStats();
+    std::vector<ARMJIT::Statistics> jitstats;
+    if (jitstatspath)
+        jitstats.reserve(numframes);
+#endif
+
+    auto benchstart = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < numframes; i++)
+    {
+        auto framestart = std::chrono::steady_clock::now();
+        RunAhead::RunFrame();
+        Rewind::Frame();
+        auto frameend = std::chrono::steady_clock::now();
+        DrainAudio();
+
+        frametimes.push_back(std::chrono::duration<double, std::milli>(frameend - framestart).count());
+#ifdef JIT_ENABLED
+        if (jitstatspath)
+            jitstats.push_back(ARMJIT::GetStats());
+#endif
+    }
+    auto benchend = std::chrono::steady_clock::now();
+
+    double total = std::chrono::duration<double>(benchend - benchstart).count();
+    double emutotal = 0;
+    for (double t : frametimes) emutotal += t;
+
+    if (framelogpath)
+    {
+        FILE* f = fopen(framelogpath, "w");
+        if (f)
+        {
+            for (double t : frametimes) fprintf(f, "%.4f\n", t);
+            fclose(f);
+        }
+        else
+            printf("failed to open frame log %s\n", framelogpath);
+    }
+
+#ifdef JIT_ENABLED
+    if (jitstatspath)
+    {
+        FILE* f = fopen(jitstatspath, "w");
+        if (f)
+        {
+            fprintf(f, "compiled,codebytes,restored,restoremisses,fastmemrewrites,slowreads,slowwrites,slowblocktransfers,resets,evictions,evictedblocks,traces");
+            for (int i = 0; i < ARMJIT_Memory::memregions_Count; i++)
+                fprintf(f, ",invalidated %s", ARMJIT_Memory::GetRegionName(i));
+            fprintf(f, "\n");
+
+            // the snapshots are cumulative, write what happened during each frame
+            ARMJIT::Statistics prev = {};
+            for (const ARMJIT::Statistics& cur : jitstats)
+            {
+                fprintf(f, "%u,%llu,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u",
+                        cur.BlocksCompiled - prev.BlocksCompiled,
+                        (unsigned long long)(cur.CodeBytes - prev.CodeBytes),
+                        cur.BlocksRestored - prev.BlocksRestored,
+                        cur.RestoreMisses - prev.RestoreMisses,
+                        cur.FastMemRewrites - prev.FastMemRewrites,
+                        cur.SlowReads - prev.SlowReads,
+                        cur.SlowWrites - prev.SlowWrites,
+                        cur.SlowBlockTransfers - prev.SlowBlockTransfers,
+                        cur.CacheResets - prev.CacheResets,
+                        cur.Evictions - prev.Evictions,
+                        cur.EvictedBlocks - prev.EvictedBlocks,
+                        cur.Traces - prev.Traces);
+                for (int i = 0; i < ARMJIT_Memory::memregions_Count; i++)
+                    fprintf(f, ",%u", cur.BlocksInvalidated[i] - prev.BlocksInvalidated[i]);
+                fprintf(f, "\n");
+                prev = cur;
+            }
+            fclose(f);
+        }
+        else
+            printf("failed to open JIT statistics file %s\n", jitstatspath);
+    }
+#endif
+
+    printf("\n");
+    printf("frames:          %u (after %u warmup)\n", numframes, warmup);
+    printf("wall time:       %.3f s\n", total);
+
+    if (numframes > 0)
+    {
+        std::vector<double> sorted = frametimes;
+        std::sort(sorted.begin(), sorted.end());
+
+        double mean = emutotal / numframes;
+        double fps = numframes / (emutotal / 1000.0);
+
+        printf("emulated FPS:    %.2f (%.1f%% of native)\n", fps, fps * 100.0 / NativeFPS);
+        printf("frame time:      mean %.3f ms, median %.3f ms, p99 %.3f ms, min %.3f ms, max %.3f ms\n",
+               mean,
+               sorted[numframes / 2],
+               sorted[std::min(numframes - 1, (u32)(numframes * 0.99))],
+               sorted.front(),
+               sorted.back());
+    }
+
+#ifdef CORE_PROFILING_ENABLED
+    printf("\nbreakdown (host time per frame):\n");
+    for (int i = 0; i < Profiling::Prof_MAX; i++)
+    {
+        const Profiling::Counter& cnt = Profiling::Get(i);
+        printf("  %-20s %9.3f ms  %5.1f%%  %12llu calls\n",
+               Profiling::GetName(i),
+               cnt.Time / 1000000.0 / std::max(numframes, 1u),
+               emutotal > 0 ? (cnt.Time / 10000.0 / emutotal) : 0.0,
+               (unsigned long long)cnt.Calls);
+    }
+
+    printf("\nevents (host time per frame):\n");
+    for (int i = 0; i < NDS::Event_MAX; i++)
+    {
+        const Profiling::Counter& cnt = Profiling::GetEvent(i);
+        if (!cnt.Calls) continue;
+
+        printf("  %-20s %9.3f ms  %5.1f%%  %12llu calls\n",
+               EventName(i),
+               cnt.Time / 1000000.0 / std::max(numframes, 1u),
+               emutotal > 0 ? (cnt.Time / 10000.0 / emutotal) : 0.0,
+               (unsigned long long)cnt.Calls);
+    }
+#else
+    printf("\n(per-subsystem breakdown unavailable, build with -DENABLE_CORE_PROFILING=ON)\n");
+#endif
+
+#ifdef JIT_ENABLED
+    if (Config::JIT_Enable)
+    {
+        const ARMJIT::Statistics& stats = ARMJIT::GetStats();
+        printf("\nJIT blocks: %u compiled (%llu bytes), %u restored, %u restore misses\n",
+               stats.BlocksCompiled, (unsigned long long)stats.CodeBytes, stats.BlocksRestored, stats.RestoreMisses);
+        printf("JIT code memory: %u evictions (%u blocks), %u full resets\n",
+               stats.Evictions, stats.EvictedBlocks, stats.CacheResets);
+        printf("JIT memory accesses: %u slow reads, %u slow writes, %u slow block transfers, %u fastmem rewrites\n",
+               stats.SlowReads, stats.SlowWrites, stats.SlowBlockTransfers, stats.FastMemRewrites);
+        for (int i = 0; i < ARMJIT_Memory::memregions_Count; i++)
+        {
+            if (stats.BlocksInvalidated[i])
+                printf("JIT blocks invalidated by writes to %s: %u\n", ARMJIT_Memory::GetRegionName(i), stats.BlocksInvalidated[i]);
+        }
+        if (Config::JIT_TieredCompilation)
+            printf("JIT tiering: %u hot blocks recompiled as traces\n", stats.Traces);
+    }
+#endif
+
+    NDS::Stop();
+    GPU::DeInitRenderer();
+    NDS::DeInit();
+    Platform::DeInit();
+
+    return 0;
+}
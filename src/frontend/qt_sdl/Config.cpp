@@ -65,12 +65,21 @@ bool ShowOSD;
 int ConsoleType;
 bool DirectBoot;
 
+bool RewindEnable;
+int RewindLength;
+int RewindInterval;
+int RewindMaxMemory;
+
+int RunAheadFrames;
+
 #ifdef JIT_ENABLED
 bool JIT_Enable = false;
 int JIT_MaxBlockSize = 32;
 bool JIT_BranchOptimisations = true;
 bool JIT_LiteralOptimisations = true;
 bool JIT_FastMemory = true;
+bool JIT_AsyncCompilation = false;
+bool JIT_TieredCompilation = false;
 #endif
 
 bool ExternalBIOSEnable;
@@ -181,6 +190,7 @@ ConfigEntry ConfigFile[] =
     {"HKKey_SolarSensorDecrease", 0, &HKKeyMapping[HK_SolarSensorDecrease], -1},
     {"HKKey_SolarSensorIncrease", 0, &HKKeyMapping[HK_SolarSensorIncrease], -1},
     {"HKKey_FrameStep",           0, &HKKeyMapping[HK_FrameStep],           -1},
+    {"HKKey_Rewind",              0, &HKKeyMapping[HK_Rewind],              -1},
 
     {"HKJoy_Lid",                 0, &HKJoyMapping[HK_Lid],                 -1},
     {"HKJoy_Mic",                 0, &HKJoyMapping[HK_Mic],                 -1},
@@ -193,6 +203,7 @@ ConfigEntry ConfigFile[] =
     {"HKJoy_SolarSensorDecrease", 0, &HKJoyMapping[HK_SolarSensorDecrease], -1},
     {"HKJoy_SolarSensorIncrease", 0, &HKJoyMapping[HK_SolarSensorIncrease], -1},
     {"HKJoy_FrameStep",           0, &HKJoyMapping[HK_FrameStep],           -1},
+    {"HKJoy_Rewind",              0, &HKJoyMapping[HK_Rewind],              -1},
 
     {"JoystickID", 0, &JoystickID, 0},
 
@@ -227,6 +238,13 @@ ConfigEntry ConfigFile[] =
     {"ConsoleType", 0, &ConsoleType, 0},
     {"DirectBoot", 1, &DirectBoot, true},
 
+    {"RewindEnable", 1, &RewindEnable, false},
+    {"RewindLength", 0, &RewindLength, 10},
+    {"RewindInterval", 0, &RewindInterval, 1},
+    {"RewindMaxMemory", 0, &RewindMaxMemory, 256},
+
+    {"RunAheadFrames", 0, &RunAheadFrames, 0},
+
 #ifdef JIT_ENABLED
     {"JIT_Enable", 1, &JIT_Enable, false},
     {"JIT_MaxBlockSize", 0, &JIT_MaxBlockSize, 32},
@@ -237,6 +255,8 @@ ConfigEntry ConfigFile[] =
     #else
         {"JIT_FastMemory", 1, &JIT_FastMemory, true},
     #endif
+    {"JIT_AsyncCompilation", 1, &JIT_AsyncCompilation, false},
+    {"JIT_TieredCompilation", 1, &JIT_TieredCompilation, false},
 #endif
 
     {"ExternalBIOSEnable", 1, &ExternalBIOSEnable, false},
@@ -35,6 +35,7 @@ enum
     HK_SolarSensorDecrease,
     HK_SolarSensorIncrease,
     HK_FrameStep,
+    HK_Rewind,
     HK_MAX
 };
 
@@ -100,12 +101,21 @@ extern bool ShowOSD;
 extern int ConsoleType;
 extern bool DirectBoot;
 
+extern bool RewindEnable;
+extern int RewindLength;
+extern int RewindInterval;
+extern int RewindMaxMemory;
+
+extern int RunAheadFrames;
+
 #ifdef JIT_ENABLED
 extern bool JIT_Enable;
 extern int JIT_MaxBlockSize;
 extern bool JIT_BranchOptimisations;
 extern bool JIT_LiteralOptimisations;
 extern bool JIT_FastMemory;
+extern bool JIT_AsyncCompilation;
+extern bool JIT_TieredCompilation;
 #endif
 
 extern bool ExternalBIOSEnable;
@@ -54,6 +54,7 @@ const int hk_general[] =
     HK_Pause,
     HK_Reset,
     HK_FrameStep,
+    HK_Rewind,
     HK_FastForward,
     HK_FastForwardToggle,
     HK_FullscreenToggle,
@@ -67,6 +68,7 @@ const char* hk_general_labels[] =
     "Pause/resume",
     "Reset",
     "Frame step",
+    "Rewind",
     "Fast forward",
     "Toggle FPS limit",
     "Toggle fullscreen",
@@ -77,7 +79,7 @@ const char* hk_general_labels[] =
 
 const int keypad_num = 12;
 const int hk_addons_num = 2;
-const int hk_general_num = 9;
+const int hk_general_num = 10;
 
 
 InputConfigDialog::InputConfigDialog(QWidget* parent) : QDialog(parent), ui(new Ui::InputConfigDialog)
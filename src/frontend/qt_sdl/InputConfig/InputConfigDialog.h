@@ -67,7 +67,7 @@ private:
 
     int keypadKeyMap[12],   keypadJoyMap[12];
     int addonsKeyMap[2],    addonsJoyMap[2];
-    int hkGeneralKeyMap[9], hkGeneralJoyMap[9];
+    int hkGeneralKeyMap[10], hkGeneralJoyMap[10];
 };
 
 
@@ -143,6 +143,12 @@ int GetConfigInt(ConfigEntry entry)
     case Firm_Color: return Config::FirmwareFavouriteColour;
 
     case AudioBitrate: return Config::AudioBitrate;
+
+    case Rewind_Length: return Config::RewindLength;
+    case Rewind_Interval: return Config::RewindInterval;
+    case Rewind_MaxMemory: return Config::RewindMaxMemory;
+
+    case RunAhead_Frames: return Config::RunAheadFrames;
     }
 
     return 0;
@@ -157,6 +163,8 @@ bool GetConfigBool(ConfigEntry entry)
     case JIT_LiteralOptimizations: return Config::JIT_LiteralOptimisations != 0;
     case JIT_BranchOptimizations: return Config::JIT_BranchOptimisations != 0;
     case JIT_FastMemory: return Config::JIT_FastMemory != 0;
+    case JIT_AsyncCompilation: return Config::JIT_AsyncCompilation != 0;
+    case JIT_TieredCompilation: return Config::JIT_TieredCompilation != 0;
 #endif
 
     case ExternalBIOSEnable: return Config::ExternalBIOSEnable != 0;
@@ -171,6 +179,8 @@ bool GetConfigBool(ConfigEntry entry)
 
     case Firm_RandomizeMAC: return Config::RandomizeMAC != 0;
     case Firm_OverrideSettings: return Config::FirmwareOverrideSettings != 0;
+
+    case Rewind_Enable: return Config::RewindEnable != 0;
     }
 
     return false;
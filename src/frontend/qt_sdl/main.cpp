@@ -80,6 +80,8 @@
 #include "Config.h"
 
 #include "Savestate.h"
+#include "Rewind.h"
+#include "RunAhead.h"
 
 #include "main_shaders.h"
 
@@ -545,7 +547,11 @@ void EmuThread::run()
 #endif
 
             // emulate
-            u32 nlines = NDS::RunFrame();
+            // when rewinding, the frame is only run to redraw the screens,
+            // as framebuffers aren't part of savestates
+            bool rewinding = Input::HotkeyDown(HK_Rewind) && Rewind::StepBack(1) > 0;
+            u32 nlines = RunAhead::RunFrame();
+            if (!rewinding) Rewind::Frame();
 
             if (ROMManager::NDSSave)
                 ROMManager::NDSSave->CheckFlush();
@@ -869,21 +869,15 @@ bool retro_load_game_special(unsigned type, const struct retro_game_info *info,
    return _handle_load_game(type, info, num);
 }
 
-#define MAX_SERIALIZE_TEST_SIZE 16 * 1024 * 1024 // The current savestate is around 7MiB so 16MiB should be enough for now
-
 size_t retro_serialize_size(void)
 {
    if (NDS::ConsoleType == 0)
    {
-      // Create the dummy savestate
-      void* data = malloc(MAX_SERIALIZE_TEST_SIZE);
-      Savestate* savestate = new Savestate(data, MAX_SERIALIZE_TEST_SIZE, true);
+      // Dry run, only measures the savestate
+      Savestate* savestate = new Savestate();
       NDS::DoSavestate(savestate);
-      // Find the offset to find the current static filesize
       size_t size = savestate->GetOffset();
-      // Free
       delete savestate;
-      free(data);
 
       return size;
    }